@@ -0,0 +1,371 @@
+#include "synthetic_media.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void putBe32(std::string& out, const uint32_t v) {
+    out += static_cast<char>(v >> 24);
+    out += static_cast<char>(v >> 16);
+    out += static_cast<char>(v >> 8);
+    out += static_cast<char>(v);
+}
+
+static void putLe16(std::string& out, const uint16_t v) {
+    out += static_cast<char>(v);
+    out += static_cast<char>(v >> 8);
+}
+
+static void putLe32(std::string& out, const uint32_t v) {
+    putLe16(out, static_cast<uint16_t>(v));
+    putLe16(out, static_cast<uint16_t>(v >> 16));
+}
+
+static void putLe64(std::string& out, const uint64_t v) {
+    putLe32(out, static_cast<uint32_t>(v));
+    putLe32(out, static_cast<uint32_t>(v >> 32));
+}
+
+static void putSyncSafe(std::string& out, const uint32_t v) {
+    out += static_cast<char>((v >> 21) & 0x7F);
+    out += static_cast<char>((v >> 14) & 0x7F);
+    out += static_cast<char>((v >> 7) & 0x7F);
+    out += static_cast<char>(v & 0x7F);
+}
+
+static std::string trackString(const SyntheticTags& tags) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u/%u", tags.track, tags.totalTracks);
+    return buf;
+}
+
+// ---------------------------------------------------------------------------
+// MP3
+// ---------------------------------------------------------------------------
+
+static void putId3Frame(std::string& out, const char* id, const std::string& body, const uint8_t version) {
+    out.append(id, 4);
+    if (version >= 4) {
+        putSyncSafe(out, body.size());
+    } else {
+        putBe32(out, body.size());
+    }
+    out.append(2, '\0'); // flags
+    out += body;
+}
+
+static void putId3Text(std::string& out, const char* id, const std::string& text, const uint8_t version) {
+    putId3Frame(out, id, std::string(1, '\0') + text, version);
+}
+
+std::string makeMp3(const SyntheticTags& tags, const Mp3Options& options) {
+    std::string out;
+
+    if (options.id3v2) {
+        std::string frames;
+        putId3Text(frames, "TIT2", tags.title, options.id3Version);
+        putId3Text(frames, "TPE1", tags.artist, options.id3Version);
+        putId3Text(frames, "TALB", tags.album, options.id3Version);
+        putId3Text(frames, "TRCK", trackString(tags), options.id3Version);
+        putId3Text(frames, "TYER", "1999", options.id3Version);
+        if (options.artBytes > 0) {
+            std::string art("\0image/jpeg\0\x03\0", 14);
+            art.append(options.artBytes, '\x5A');
+            putId3Frame(frames, "APIC", art, options.id3Version);
+        }
+        frames.append(256, '\0'); // padding
+
+        out += "ID3";
+        out += static_cast<char>(options.id3Version);
+        out += '\0';
+        out += '\0';
+        putSyncSafe(out, frames.size());
+        out += frames;
+    }
+
+    // MPEG1 Layer 3, 128 kbps, 44.1 kHz, stereo: 417 byte frames
+    static const uint8_t header[4] = {0xFF, 0xFB, 0x90, 0x64};
+    constexpr uint16_t frameLength = 417;
+    for (uint16_t i = 0; i < options.frames; i++) {
+        std::string frame(reinterpret_cast<const char*>(header), 4);
+        frame.append(frameLength - 4, '\0');
+        if (i == 0 && options.xing) {
+            std::string xing = "Xing";
+            putBe32(xing, 0x01);
+            putBe32(xing, options.frames - 1);
+            frame.replace(4 + 32, xing.size(), xing);
+        }
+        out += frame;
+    }
+
+    if (options.id3v1) {
+        std::string tag = "TAG";
+        auto field = [&tag](const std::string& s, const size_t n) {
+            std::string f = s.substr(0, n);
+            f.append(n - f.size(), ' ');
+            tag += f;
+        };
+        field(tags.title, 30);
+        field(tags.artist, 30);
+        field(tags.album, 30);
+        field("1999", 4);
+        tag.append(28, ' ');
+        tag += '\0';
+        tag += static_cast<char>(tags.track);
+        tag += '\x0C';
+        out += tag;
+    }
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// OGG
+// ---------------------------------------------------------------------------
+
+static uint32_t oggCrc(const std::string& data) {
+    uint32_t crc = 0;
+    for (const char c : data) {
+        crc ^= static_cast<uint32_t>(static_cast<uint8_t>(c)) << 24;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80000000u) ? (crc << 1) ^ 0x04C11DB7u : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static std::string oggPage(const std::string& payload, const uint64_t granule, const uint32_t sequence, const uint8_t type) {
+    std::string segments;
+    size_t remaining = payload.size();
+    while (remaining >= 255) {
+        segments += '\xFF';
+        remaining -= 255;
+    }
+    segments += static_cast<char>(remaining);
+
+    std::string page = "OggS";
+    page += '\0';
+    page += static_cast<char>(type);
+    putLe64(page, granule);
+    putLe32(page, 0x1234);  // stream serial
+    putLe32(page, sequence);
+    putLe32(page, 0);       // CRC, filled in below
+    page += static_cast<char>(segments.size());
+    page += segments;
+    page += payload;
+
+    const uint32_t crc = oggCrc(page);
+    std::string crcBytes;
+    putLe32(crcBytes, crc);
+    page.replace(22, 4, crcBytes);
+    return page;
+}
+
+std::string makeOgg(const SyntheticTags& tags, const OggOptions& options) {
+    std::string ident = "\x01vorbis";
+    putLe32(ident, 0);       // version
+    ident += '\x02';         // channels
+    putLe32(ident, 44100);   // sample rate
+    putLe32(ident, 0);
+    putLe32(ident, 128000);
+    putLe32(ident, 0);
+    ident += '\xB8';
+    ident += '\x01';
+
+    std::string comments;
+    for (uint16_t i = 0; i < options.extraComments; i++) {
+        char buf[48];
+        snprintf(buf, sizeof(buf), "COMMENT%u=synthetic comment number %u", i, i);
+        comments += buf;
+        comments += '\n';
+    }
+    if (options.tags) {
+        comments += "TITLE=" + tags.title + "\n";
+        comments += "ARTIST=" + tags.artist + "\n";
+        comments += "ALBUM=" + tags.album + "\n";
+        comments += "TRACKNUMBER=" + std::to_string(tags.track) + "\n";
+        comments += "TRACKTOTAL=" + std::to_string(tags.totalTracks) + "\n";
+    }
+
+    std::string comment = "\x03vorbis";
+    const char* vendor = "synthetic";
+    putLe32(comment, strlen(vendor));
+    comment += vendor;
+    uint32_t count = 0;
+    std::string list;
+    size_t start = 0;
+    size_t end;
+    while ((end = comments.find('\n', start)) != std::string::npos) {
+        putLe32(list, end - start);
+        list += comments.substr(start, end - start);
+        count++;
+        start = end + 1;
+    }
+    putLe32(comment, count);
+    comment += list;
+    comment += '\x01';
+
+    std::string out = oggPage(ident, 0, 0, 0x02);
+    out += oggPage(comment, 0, 1, 0x00);
+    uint64_t granule = 0;
+    for (uint16_t i = 0; i < options.pages; i++) {
+        granule += 4096;
+        const bool last = i + 1 == options.pages;
+        out += oggPage(std::string(4000, '\x55'), granule, i + 2, last ? 0x04 : 0x00);
+    }
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// WAV
+// ---------------------------------------------------------------------------
+
+static void putInfo(std::string& out, const char* id, const std::string& value) {
+    std::string v = value;
+    v += '\0';
+    out.append(id, 4);
+    putLe32(out, v.size());
+    out += v;
+    if (v.size() & 1) out += '\0';
+}
+
+std::string makeWav(const SyntheticTags& tags, const WavOptions& options) {
+    std::string fmt = "fmt ";
+    putLe32(fmt, 16);
+    putLe16(fmt, 1);         // PCM
+    putLe16(fmt, 2);         // channels
+    putLe32(fmt, 44100);
+    putLe32(fmt, 44100 * 4);
+    putLe16(fmt, 4);
+    putLe16(fmt, 16);
+
+    std::string list;
+    if (options.tags || options.extraInfoChunks > 0) {
+        std::string info = "INFO";
+        for (uint16_t i = 0; i < options.extraInfoChunks; i++) {
+            putInfo(info, "ICMT", "A long synthetic comment that pads out the INFO list chunk " + std::to_string(i));
+        }
+        if (options.tags) {
+            putInfo(info, "INAM", tags.title);
+            putInfo(info, "IART", tags.artist);
+            putInfo(info, "IPRD", tags.album);
+            putInfo(info, "ITRK", std::to_string(tags.track));
+        }
+        list = "LIST";
+        putLe32(list, info.size());
+        list += info;
+    }
+
+    std::string data = "data";
+    putLe32(data, options.dataBytes);
+    data.append(options.dataBytes, '\0');
+
+    std::string riff = "WAVE" + fmt + list + data;
+    std::string out = "RIFF";
+    putLe32(out, riff.size());
+    out += riff;
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// Files and trees
+// ---------------------------------------------------------------------------
+
+bool writeFile(const std::string& path, const std::string& data) {
+    FILE* fp = fopen(path.c_str(), "wb");
+    if (!fp) return false;
+    const bool ok = fwrite(data.data(), 1, data.size(), fp) == data.size();
+    fclose(fp);
+    return ok;
+}
+
+TreeSummary generateTree(const std::string& root, const TreeOptions& options) {
+    TreeSummary summary;
+    char name[32];
+
+    for (uint16_t a = 0; a < options.artists; a++) {
+        snprintf(name, sizeof(name), "/ART%03u", a);
+        std::string artistDir = root + name;
+        mkdir(artistDir.c_str(), 0755);
+
+        // Every third artist keeps albums in nested folders (e.g. by decade/format)
+        std::string parent = artistDir;
+        if (a % 3 == 2) {
+            for (uint8_t depth = 2; depth < options.maxDepth; depth++) {
+                snprintf(name, sizeof(name), "/SUB%u", depth);
+                parent += name;
+                mkdir(parent.c_str(), 0755);
+            }
+        }
+
+        for (uint16_t b = 0; b < options.albumsPerArtist; b++) {
+            snprintf(name, sizeof(name), "/ALB%03u", b);
+            const std::string albumDir = parent + name;
+            mkdir(albumDir.c_str(), 0755);
+            summary.albums++;
+
+            const uint16_t kind = (a * options.albumsPerArtist + b) % 6;
+            for (uint16_t t = 1; t <= options.tracksPerAlbum; t++) {
+                SyntheticTags tags;
+                tags.title = "Track " + std::to_string(t) + " of album " + std::to_string(b);
+                tags.artist = "Artist " + std::to_string(a);
+                tags.album = "Album " + std::to_string(b);
+                tags.track = static_cast<uint8_t>(t);
+                tags.totalTracks = static_cast<uint8_t>(options.tracksPerAlbum);
+
+                std::string data;
+                const char* ext;
+                if (kind <= 3) {
+                    Mp3Options mp3;
+                    mp3.id3Version = kind == 1 ? 4 : 3;
+                    mp3.artBytes = (kind == 2 && t == 1) ? 65536 : 0;
+                    mp3.id3v1 = kind == 3;
+                    mp3.xing = kind == 3;
+                    data = makeMp3(tags, mp3);
+                    ext = "MP3";
+                } else if (kind == 4) {
+                    OggOptions ogg;
+                    ogg.extraComments = 8;
+                    data = makeOgg(tags, ogg);
+                    ext = "OGG";
+                } else {
+                    data = makeWav(tags, WavOptions());
+                    ext = "WAV";
+                }
+
+                snprintf(name, sizeof(name), "/T%02u.%s", t, ext);
+                writeFile(albumDir + name, data);
+                summary.files++;
+                summary.bytes += data.size();
+            }
+            // Non-audio files that scanning has to step over
+            writeFile(albumDir + "/FOLDER.JPG", std::string(2048, '\x11'));
+        }
+    }
+    return summary;
+}
+
+std::string makeTempDir(const char* prefix) {
+    std::string templ = std::string("/tmp/") + prefix + "XXXXXX";
+    char* path = mkdtemp(&templ[0]);
+    return path ? std::string(path) : std::string();
+}
+
+void removeTree(const std::string& path) {
+    DIR* dir = opendir(path.c_str());
+    if (dir) {
+        while (const dirent* ent = readdir(dir)) {
+            if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) continue;
+            const std::string child = path + "/" + ent->d_name;
+            struct stat st{};
+            if (lstat(child.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+                removeTree(child);
+            } else {
+                unlink(child.c_str());
+            }
+        }
+        closedir(dir);
+    }
+    rmdir(path.c_str());
+}
@@ -0,0 +1,70 @@
+// Generators for synthetic audio files and SD card layouts used by the
+// native benchmarks. The files carry realistic tag structures (ID3v2/ID3v1,
+// Vorbis comments, RIFF INFO) around a minimal amount of audio data.
+
+#ifndef BOOMERBOX_SYNTHETIC_MEDIA_H
+#define BOOMERBOX_SYNTHETIC_MEDIA_H
+
+#include <cstdint>
+#include <string>
+
+struct SyntheticTags {
+    std::string title;
+    std::string artist;
+    std::string album;
+    uint8_t track = 0;
+    uint8_t totalTracks = 0;
+};
+
+struct Mp3Options {
+    bool id3v2 = true;
+    uint8_t id3Version = 3;      // 3 or 4
+    uint32_t artBytes = 0;       // size of an APIC (cover art) frame, 0 for none
+    bool id3v1 = false;
+    bool xing = false;           // Xing VBR header in the first frame
+    uint16_t frames = 64;
+};
+
+struct OggOptions {
+    bool tags = true;
+    uint16_t extraComments = 0;  // additional Vorbis comments before the useful ones
+    uint16_t pages = 16;         // audio pages after the headers
+};
+
+struct WavOptions {
+    bool tags = true;
+    uint16_t extraInfoChunks = 0; // additional INFO sub-chunks (ICMT etc.)
+    uint32_t dataBytes = 4096;
+};
+
+std::string makeMp3(const SyntheticTags& tags, const Mp3Options& options);
+std::string makeOgg(const SyntheticTags& tags, const OggOptions& options);
+std::string makeWav(const SyntheticTags& tags, const WavOptions& options);
+
+bool writeFile(const std::string& path, const std::string& data);
+
+struct TreeOptions {
+    uint16_t artists = 10;
+    uint16_t albumsPerArtist = 5;
+    uint16_t tracksPerAlbum = 12;
+    // Deepest album directory, counted like scan_dir() depth (an album in
+    // /ARTIST/ALBUM is at depth 2). Every third artist's albums are nested
+    // this deep; the rest sit at depth 2.
+    uint8_t maxDepth = 4;
+};
+
+struct TreeSummary {
+    uint32_t albums = 0;
+    uint32_t files = 0;
+    uint64_t bytes = 0;
+};
+
+// Generate a card layout of artists/albums/tracks under root, cycling
+// through MP3 (ID3v2.3 and 2.4, with and without art), OGG and WAV albums.
+TreeSummary generateTree(const std::string& root, const TreeOptions& options);
+
+// Create a fresh directory under /tmp, and remove a directory tree
+std::string makeTempDir(const char* prefix);
+void removeTree(const std::string& path);
+
+#endif // BOOMERBOX_SYNTHETIC_MEDIA_H
@@ -0,0 +1,374 @@
+// LCD driver benchmark: draws the player's screens through Lcd twice, once
+// writing each changed cell through Adafruit_LiquidCrystal as before and once
+// through the batched driver, and reports the I2C traffic of each. The host
+// Wire bus models the backpack down to the HD44780, and after every step the
+// batched run must leave the same characters on screen as the library did.
+// Custom glyphs count as what their CGRAM slot holds. It also counts heap
+// allocations made while drawing, which should be none.
+//
+//   pio run -e bench_lcd
+//   .pio/build/bench_lcd/program [--albums N] [--seconds S] [--khz K]
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <lcd.h>
+#include <lcd_charset.h>
+#include <cstdio>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+static uint32_t errors = 0;
+
+// Heap allocations while a scenario draws; not while the bench looks at the screen
+static bool counting = false;
+static uint32_t allocations = 0;
+
+void* operator new(const size_t size) {
+    if (counting) allocations++;
+    void* block = malloc(size ? size : 1);
+    if (!block) throw std::bad_alloc();
+    return block;
+}
+
+void operator delete(void* block) noexcept {
+    free(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+    free(block);
+}
+
+static void fail(const char* what, const uint32_t value) {
+    if (errors++ < 10) printf("  FAIL: %s (%u)\n", what, value);
+}
+
+static std::string screen() {
+    std::string text;
+    for (uint8_t row = 0; row < Lcd::ROWS; row++) {
+        for (uint8_t col = 0; col < Lcd::COLS; col++) {
+            const char c = host_lcd_at(row, col);
+            text += c;
+            // A CGRAM code, as its slot's glyph
+            if (static_cast<uint8_t>(c) < 0x10) text.append(reinterpret_cast<const char*>(host_lcd_glyph(c & 7)), 8);
+        }
+    }
+    return text;
+}
+
+// The display shows text centred on row, each custom glyph from a slot
+// holding it or, for want of a slot, as its base letter; those are counted
+static bool shows(const uint8_t row, const std::string& text, uint32_t& baseLetters) {
+    const uint8_t start = (Lcd::COLS - text.size()) / 2;
+    for (uint8_t col = 0; col < Lcd::COLS; col++) {
+        const char wanted = col >= start && static_cast<size_t>(col - start) < text.size() ? text[col - start] : ' ';
+        const char c = host_lcd_at(row, col);
+        if (!isLcdGlyph(wanted)) {
+            if (c != wanted) return false;
+        } else if (c == lcdBaseChar(wanted)) {
+            baseLetters++;
+        } else if (static_cast<uint8_t>(c) >= 0x10 || memcmp(host_lcd_glyph(c & 7), lcdGlyphRows(wanted), 8) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Glyph slots on screen
+static uint8_t slotsShown() {
+    uint8_t slots = 0;
+    for (uint8_t row = 0; row < Lcd::ROWS; row++) {
+        for (uint8_t col = 0; col < Lcd::COLS; col++) {
+            const uint8_t c = host_lcd_at(row, col);
+            if (c >= 0x08 && c < 0x10 && c != 0x08 + CHAR_UP && c != 0x08 + CHAR_DOWN) slots |= 1 << (c & 7);
+        }
+    }
+    return __builtin_popcount(slots);
+}
+
+// Tag text as the metadata parser leaves it
+static std::string decode(const char* text, const size_t length, const TextEncoding encoding) {
+    char codes[128];
+    return std::string(codes, lcdTranscode(text, length, encoding, codes, sizeof(codes)));
+}
+
+static std::string decode(const char* utf8) {
+    return decode(utf8, strlen(utf8), TextEncoding::UTF8);
+}
+
+struct Library {
+    std::vector<Album> albums;
+
+    explicit Library(const uint16_t count) : albums(count) {
+        for (uint16_t i = 0; i < count; i++) {
+            Album& album = albums[i];
+            snprintf(album.artist, sizeof(album.artist), "Artist %u", i);
+            snprintf(album.title, sizeof(album.title), "A Rather Long Album Title %u", i);
+            album.index = i;
+            album.song_count = 12;
+            album.strings.reserve(512);
+            album.songs = new Song[album.song_count];
+            for (uint8_t t = 0; t < album.song_count; t++) {
+                Song& song = album.songs[t];
+                char title[32];
+                snprintf(title, sizeof(title), "Song number %u", t + 1);
+                song.title = album.strings.add(title);
+                song.album = album.strings.add(album.title);
+                song.artist = album.strings.add(album.artist);
+                song.duration = 180 + t * 7;
+                song.trackNumber = t + 1;
+            }
+            album.loaded = true;
+        }
+    }
+
+    ~Library() {
+        for (Album& album : albums) album.unload();
+    }
+};
+
+struct Scenario {
+    const char* name;
+    std::function<void(Lcd&, const std::function<void()>&)> run;  // calls step() after each screen
+};
+
+struct Traffic {
+    uint32_t transactions = 0;
+    uint32_t bytes = 0;
+    uint32_t cells = 0;
+    uint32_t allocations = 0;
+};
+
+static Traffic runScenario(const Scenario& scenario, const bool batched, std::vector<std::string>& screens) {
+    Lcd lcd(0x20);
+    lcd.set_batched(batched);
+    if (!lcd.begin()) fail("begin", batched);
+    lcd.set_backlight(true);
+    host_i2c_stats.reset();
+    lcd.stats.reset();
+    size_t step = 0;
+    const std::function<void()> check = [&] {
+        counting = false;
+        const std::string shown = screen();
+        if (!batched) {
+            screens.push_back(shown);
+        } else if (step >= screens.size() || screens[step] != shown) {
+            fail("screen differs from the library's", step);
+        }
+        step++;
+        counting = true;
+    };
+    allocations = 0;
+    counting = true;
+    scenario.run(lcd, check);
+    counting = false;
+
+    Traffic traffic;
+    traffic.transactions = host_i2c_stats.transactions;
+    traffic.bytes = host_i2c_stats.bytes;
+    traffic.cells = lcd.stats.cells;
+    traffic.allocations = allocations;
+    if (batched && lcd.stats.transactions != traffic.transactions) {
+        fail("LcdStats transactions differ from the bus", lcd.stats.transactions);
+    }
+    if (lcd.stats.errors) fail("unacknowledged transactions", lcd.stats.errors);
+    return traffic;
+}
+
+// Start, address byte and stop on top of the data, 9 clocks a byte
+static double busMs(const Traffic& traffic, const double khz) {
+    const double clocks = traffic.transactions * (9.0 + 2.0) + traffic.bytes * 9.0;
+    return clocks / khz;
+}
+
+int main(int argc, char** argv) {
+    uint16_t albums = 50;
+    uint16_t seconds = 60;
+    double khz = 100.0;
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--albums") == 0 && hasValue) {
+            albums = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seconds") == 0 && hasValue) {
+            seconds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--khz") == 0 && hasValue) {
+            khz = atof(argv[++i]);
+        } else {
+            printf("usage: %s [--albums N] [--seconds S] [--khz K]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (albums < 2) albums = 2;
+
+    Library library(albums);
+
+    // Every line of the playing screen but the last too long for the display
+    Album classical;
+    strcpy(classical.title, "Symphony No. 9 in D minor, Op. 125 (Choral)");
+    strcpy(classical.artist, "Berliner Philharmoniker, Herbert von Karajan");
+    classical.strings.reserve(256);
+    classical.song_count = 4;
+    classical.songs = new Song[classical.song_count];
+    for (uint8_t t = 0; t < classical.song_count; t++) {
+        Song& song = classical.songs[t];
+        song.title = classical.strings.add("IV. Presto - Allegro assai - Presto: O Freunde, nicht diese Tone");
+        song.album = classical.strings.add(classical.title);
+        song.artist = classical.strings.add(classical.artist);
+        song.duration = 1500;
+        song.trackNumber = t + 1;
+    }
+
+    // Accented names: artist, album, song. Some screens want more glyphs
+    // than there are slots; going from the fourth album's playing screen to
+    // the fifth's list, the artist is short of a slot until the row below
+    // lets go of its glyphs.
+    const char utf16[] = "\xff\xfeS\0i\0g\0u\0r\0 \0R\0\xf3\0s\0";
+    const std::string accentedNames[][3] = {
+        {decode("Bj\xc3\xb6rk"), decode("Vesp\xc3\xa9rtine"), decode("Aur\xc3\xb3ra")},
+        {decode("\xc3\x89" "dith Piaf"), decode("La Vie en Ros\xc3\xa9 \xc3\xa0 \xc3\xa8"), decode("Hymne \xc3\xa0 l'amour")},
+        {decode("Fran\xc3\xa7oise Hardy"), decode("Tous les gar\xc3\xa7ons"), decode("\xc3\x87" "a a d\xc3\xa9j\xc3\xa0 commenc\xc3\xa9")},
+        {decode("Trio \xc3\xb2\xc3\xb3\xc3\xb4"), decode("Plain Title"), decode("Il \xc3\xac\xc3\xad\xc3\xae")},
+        {decode("\xc3\xa9\xc3\xa8\xc3\xaa\xc3\xab Quartet"), decode("Strings"), decode("\xc3\xa0\xc3\xa1\xc3\xa2\xc3\xa3\xc3\xa5\xc3\xa7\xc3\xb9")},
+        {decode(utf16, sizeof(utf16) - 1, TextEncoding::UTF16), decode("\xc3\x81g\xc3\xa6tis byrjun"), decode("Sv\xc3\xa9" "fn-g-englar")},
+        {decode("Mot\xf6rhead", 9, TextEncoding::LATIN1), decode("Ace of Spades"), decode("We Are the Road Crew")},
+    };
+    if (accentedNames[5][0] != decode("Sigur R\xc3\xb3s")) fail("UTF-16 decoded differently from UTF-8", 0);
+    const uint16_t accentedCount = sizeof(accentedNames) / sizeof(accentedNames[0]);
+    std::vector<Album> accented(accentedCount);
+    for (uint16_t i = 0; i < accentedCount; i++) {
+        Album& album = accented[i];
+        strcpy(album.artist, accentedNames[i][0].c_str());
+        strcpy(album.title, accentedNames[i][1].c_str());
+        album.index = i;
+        // Two songs, or a song titled as its album would not show its title
+        album.song_count = 2;
+        album.strings.reserve(128);
+        album.songs = new Song[album.song_count];
+        for (uint8_t t = 0; t < album.song_count; t++) {
+            Song& song = album.songs[t];
+            song.title = album.strings.add(accentedNames[i][2].c_str());
+            song.album = album.strings.add(album.title);
+            song.artist = album.strings.add(album.artist);
+            song.duration = 200;
+            song.trackNumber = t + 1;
+        }
+        album.loaded = true;
+    }
+
+    const uint16_t marqueeSteps = 120;
+    std::string marqueeStart;
+    const std::vector<Scenario> scenarios = {
+        {"album list <-> playing", [&](Lcd& lcd, const std::function<void()>& step) {
+            for (uint16_t i = 0; i < albums; i++) {
+                const Album& album = library.albums[i];
+                lcd.display_album_list(&album, albums, i);
+                step();
+                lcd.display_playing(&album.songs[0], &album, 0);
+                step();
+            }
+        }},
+        {"progress, 1 s ticks", [&](Lcd& lcd, const std::function<void()>& step) {
+            const Album& album = library.albums[0];
+            for (uint16_t s = 0; s < seconds; s++) {
+                lcd.display_playing(&album.songs[s * album.song_count / seconds], &album, s);
+                step();
+            }
+        }},
+        {"ui task at 20 Hz", [&](Lcd& lcd, const std::function<void()>& step) {
+            // Redrawn every pass, but the screen only changes once a second
+            const Album& album = library.albums[1];
+            for (uint32_t tick = 0; tick < seconds * 20u; tick++) {
+                lcd.display_playing(&album.songs[0], &album, tick / 20);
+                if (tick % 20 == 0) step();
+            }
+        }},
+        {"browsing the list", [&](Lcd& lcd, const std::function<void()>& step) {
+            for (uint16_t i = 0; i < albums; i++) {
+                lcd.display_album_list(&library.albums[i], albums, i);
+                step();
+            }
+        }},
+        {"marquee, 3 long lines", [&](Lcd& lcd, const std::function<void()>& step) {
+            // Steps on a clock of its own, as fast as the bench runs
+            uint32_t now = millis();
+            lcd.display_playing(&classical.songs[3], &classical, 0);
+            counting = false;
+            marqueeStart = screen();
+            counting = true;
+            step();
+            for (uint16_t i = 0; i < marqueeSteps; i++) {
+                now += Lcd::MARQUEE_STEP_MS;
+                if (!lcd.scroll_due(now)) fail("scroll not due", i);
+                lcd.scroll(now);
+                if (i == Lcd::MARQUEE_PAUSE_STEPS) {
+                    // Paused at the start, then one character on
+                    counting = false;
+                    const std::string title = classical.text(classical.songs[3].title);
+                    if (screen().substr(0, 20) != title.substr(1, 20)) fail("marquee did not move on", i);
+                    counting = true;
+                }
+                // The progress line ticks under it
+                lcd.display_playing(&classical.songs[3], &classical, (i + 1) * Lcd::MARQUEE_STEP_MS / 1000);
+                step();
+            }
+        }},
+        {"accented names", [&](Lcd& lcd, const std::function<void()>& step) {
+            // A letter may only go without its glyph while every slot is on screen
+            const auto checkShown = [&](const uint16_t i, const uint8_t firstRow, const uint8_t rows) {
+                counting = false;
+                uint32_t baseLetters = 0;
+                for (uint8_t row = firstRow; row < firstRow + rows; row++) {
+                    // Rows from the top are song, album, artist; the list has artist, album
+                    const std::string& text = rows == 3 ? accentedNames[i][2 - row] : accentedNames[i][row == 1 ? 0 : 1];
+                    if (!shows(row, text, baseLetters)) fail("accented row not shown", i * 10 + row);
+                }
+                if (baseLetters && slotsShown() != Lcd::GLYPH_SLOTS) fail("glyph left out with a slot free", i);
+                counting = true;
+            };
+            for (uint16_t i = 0; i < accentedCount; i++) {
+                const Album& album = accented[i];
+                lcd.display_album_list(&album, accentedCount, i);
+                checkShown(i, 1, 2);
+                step();
+                lcd.display_playing(&album.songs[0], &album, 0);
+                checkShown(i, 0, 3);
+                step();
+            }
+        }},
+        {"splash and errors", [&](Lcd& lcd, const std::function<void()>& step) {
+            lcd.display_splash("Music Box", "Initializing...");
+            step();
+            lcd.display_splash("Music Box", "Scanning...");
+            step();
+            lcd.display_error("Album load failed");
+            step();
+            lcd.display_character(CHAR_DOWN, 3, 19);
+            step();
+        }},
+    };
+
+    printf("%-24s %8s %22s %22s %14s %7s\n", "", "cells", "transactions", "bytes", "bus ms", "allocs");
+    for (const Scenario& scenario : scenarios) {
+        std::vector<std::string> screens;
+        const Traffic library_path = runScenario(scenario, false, screens);
+        const Traffic batched = runScenario(scenario, true, screens);
+        if (library_path.cells != batched.cells) fail("cell counts differ", batched.cells);
+        if (batched.allocations) fail("heap allocations while drawing", batched.allocations);
+        printf("%-24s %8u %10u -> %-9u %10u -> %-9u %6.0f -> %-6.0f %7u\n", scenario.name, batched.cells,
+               library_path.transactions, batched.transactions, library_path.bytes, batched.bytes,
+               busMs(library_path, khz), busMs(batched, khz), batched.allocations);
+    }
+
+    // The last screens are known, so the two runs are not merely alike
+    const std::string title = classical.text(classical.songs[3].title);
+    if (marqueeStart.substr(0, 20) != title.substr(0, 20)) fail("marquee does not start at the start", 0);
+    const std::string last = screen();
+    if (last.substr(20, 20) != "       ERROR        ") fail("ERROR not centred on row 1", 0);
+    if (last[79] != CHAR_DOWN) fail("character not written", 0);
+
+    classical.unload();
+    for (Album& album : accented) album.unload();
+    printf("errors: %u\n", errors);
+    return errors == 0 ? 0 : 2;
+}
@@ -0,0 +1,155 @@
+// Metadata parser microbenchmark: runs parseWavMetadata(), parseMp3Metadata()
+// and parseOggMetadata() over a generated corpus and reports throughput and,
+// more importantly for the device, SD calls per parsed file.
+//
+//   pio run -e bench_parse
+//   .pio/build/bench_parse/program [--iterations N] [--keep]
+
+#include <Arduino.h>
+#include <SD.h>
+#include <storage.h>
+#include <metadata_parser.h>
+#include <sector_cache.h>
+#include "../bench/synthetic_media.h"
+#include <cstdio>
+#include <vector>
+
+enum class Format { MP3, OGG, WAV };
+
+struct CorpusFile {
+    const char* name;
+    Format format;
+    std::string data;
+};
+
+static SyntheticTags corpusTags() {
+    SyntheticTags tags;
+    tags.title = "A Reasonably Long Track Title";
+    tags.artist = "Some Artist";
+    tags.album = "Some Album";
+    tags.track = 7;
+    tags.totalTracks = 12;
+    return tags;
+}
+
+static std::vector<CorpusFile> buildCorpus() {
+    const SyntheticTags tags = corpusTags();
+    std::vector<CorpusFile> corpus;
+
+    Mp3Options mp3;
+    mp3.frames = 2000;
+    corpus.push_back({"mp3 id3v2.3", Format::MP3, makeMp3(tags, mp3)});
+    mp3.id3Version = 4;
+    corpus.push_back({"mp3 id3v2.4", Format::MP3, makeMp3(tags, mp3)});
+    mp3.id3Version = 3;
+    mp3.artBytes = 1024 * 1024;
+    corpus.push_back({"mp3 1MB APIC", Format::MP3, makeMp3(tags, mp3)});
+    mp3.artBytes = 0;
+    mp3.xing = true;
+    corpus.push_back({"mp3 xing", Format::MP3, makeMp3(tags, mp3)});
+    mp3.xing = false;
+    mp3.id3v2 = false;
+    mp3.id3v1 = true;
+    corpus.push_back({"mp3 id3v1 only", Format::MP3, makeMp3(tags, mp3)});
+    mp3.id3v1 = false;
+    corpus.push_back({"mp3 no tags", Format::MP3, makeMp3(tags, mp3)});
+
+    OggOptions ogg;
+    ogg.pages = 200;
+    corpus.push_back({"ogg comments", Format::OGG, makeOgg(tags, ogg)});
+    ogg.extraComments = 400;
+    corpus.push_back({"ogg 400 comments", Format::OGG, makeOgg(tags, ogg)});
+    ogg.extraComments = 0;
+    ogg.tags = false;
+    corpus.push_back({"ogg no tags", Format::OGG, makeOgg(tags, ogg)});
+
+    WavOptions wav;
+    wav.dataBytes = 1024 * 1024;
+    corpus.push_back({"wav info", Format::WAV, makeWav(tags, wav)});
+    wav.extraInfoChunks = 200;
+    corpus.push_back({"wav long info", Format::WAV, makeWav(tags, wav)});
+    wav.extraInfoChunks = 0;
+    wav.tags = false;
+    corpus.push_back({"wav no tags", Format::WAV, makeWav(tags, wav)});
+
+    return corpus;
+}
+
+static bool parse(const Format format, StorageFile& file, SongMetadata& metadata) {
+    switch (format) {
+        case Format::MP3: return parseMp3Metadata(file, metadata);
+        case Format::OGG: return parseOggMetadata(file, metadata);
+        case Format::WAV: return parseWavMetadata(file, metadata);
+    }
+    return false;
+}
+
+int main(int argc, char** argv) {
+    uint32_t iterations = 200;
+    bool keep = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--keep") == 0) {
+            keep = true;
+        } else {
+            fprintf(stderr, "usage: %s [--iterations N] [--keep]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    const std::string root = makeTempDir("boomerbox_parse_");
+    if (root.empty()) {
+        fprintf(stderr, "failed to create a temporary directory\n");
+        return 1;
+    }
+    std::vector<CorpusFile> corpus = buildCorpus();
+    for (size_t i = 0; i < corpus.size(); i++) {
+        static const char* extensions[] = {"mp3", "ogg", "wav"};
+        char name[32];
+        snprintf(name, sizeof(name), "/f%02zu.%s", i, extensions[static_cast<int>(corpus[i].format)]);
+        writeFile(root + name, corpus[i].data);
+        corpus[i].data = name; // keep the card path, drop the contents
+    }
+
+    SD.setRoot(root.c_str());
+    SD.begin();
+    Serial.enabled = false;
+
+    printf("%-18s %9s %10s %8s %8s %10s %6s %6s  %s\n",
+           "file", "size KB", "files/s", "reads", "seeks", "bytes", "hits", "misses", "result");
+
+    for (const CorpusFile& entry : corpus) {
+        StorageFile file = storage.open(entry.data.c_str());
+        const uint32_t size = file.size();
+        SongMetadata metadata{};
+
+        // Per-file call counts from a single parse
+        host_io_stats.reset();
+        sector_cache.stats.reset();
+        const bool ok = parse(entry.format, file, metadata);
+        const HostIoStats io = host_io_stats;
+        const SectorCacheStats cache = sector_cache.stats;
+
+        const unsigned long start = micros();
+        for (uint32_t i = 0; i < iterations; i++) {
+            parse(entry.format, file, metadata);
+        }
+        const double seconds = (micros() - start) / 1e6;
+        file.close();
+
+        char result[96];
+        snprintf(result, sizeof(result), "%s%s / %lus / #%u", ok ? "" : "FAILED ",
+                 metadata.title.c_str(), static_cast<unsigned long>(metadata.duration), metadata.trackNumber);
+        printf("%-18s %9.1f %10.0f %8u %8u %10llu %6u %6u  %s\n",
+               entry.name, size / 1024.0, seconds > 0 ? iterations / seconds : 0.0,
+               io.readCalls, io.seekCalls, static_cast<unsigned long long>(io.bytesRead),
+               cache.hits, cache.misses, result);
+    }
+
+    if (!keep) {
+        removeTree(root);
+    }
+    return 0;
+}
@@ -0,0 +1,140 @@
+// Library scan benchmark: generates a synthetic card layout and measures
+// scan_songs() (cold, with an up-to-date catalog, and after one album
+// changed) and loadAlbumSongs() over it.
+//
+//   pio run -e bench_scan
+//   .pio/build/bench_scan/program [--artists N] [--albums M] [--tracks K]
+//                                 [--depth D] [--runs R] [--keep]
+
+#include <Arduino.h>
+#include <SD.h>
+#include <library.h>
+#include <catalog.h>
+#include <dir_listing.h>
+#include "../bench/synthetic_media.h"
+#include <cstdio>
+#include <functional>
+#include <unistd.h>
+
+struct PhaseResult {
+    const char* name;
+    double bestMs;
+    HostIoStats io;
+    DirStats dirs;
+};
+
+static PhaseResult measure(const char* name, const uint16_t runs,
+                           const std::function<void()>& prepare, const std::function<void()>& body) {
+    PhaseResult result{name, 0.0, HostIoStats(), DirStats()};
+    for (uint16_t run = 0; run < runs; run++) {
+        prepare();
+        host_io_stats.reset();
+        dir_stats.reset();
+        const unsigned long start = micros();
+        body();
+        const double ms = (micros() - start) / 1000.0;
+        if (run == 0 || ms < result.bestMs) {
+            result.bestMs = ms;
+        }
+        result.io = host_io_stats;
+        result.dirs = dir_stats;
+    }
+    return result;
+}
+
+static void printResult(const PhaseResult& r, const uint32_t albums) {
+    printf("%-22s %9.2f %7u %7u %8u %7u %8u %10llu %7u %7u %9.1f\n",
+           r.name, r.bestMs, r.io.dirOpens, r.io.fileOpens, r.io.dirReads, r.dirs.passes, r.io.readCalls,
+           static_cast<unsigned long long>(r.io.bytesRead), r.io.seekCalls, r.io.writeCalls,
+           albums ? static_cast<double>(r.io.readCalls + r.io.seekCalls + r.io.dirReads) / albums : 0.0);
+}
+
+int main(int argc, char** argv) {
+    TreeOptions tree;
+    uint16_t runs = 3;
+    bool keep = false;
+
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--artists") == 0 && hasValue) {
+            tree.artists = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--albums") == 0 && hasValue) {
+            tree.albumsPerArtist = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--tracks") == 0 && hasValue) {
+            tree.tracksPerAlbum = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--depth") == 0 && hasValue) {
+            tree.maxDepth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--runs") == 0 && hasValue) {
+            runs = max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--keep") == 0) {
+            keep = true;
+        } else {
+            fprintf(stderr, "usage: %s [--artists N] [--albums M] [--tracks K] [--depth D] [--runs R] [--keep]\n", argv[0]);
+            return 1;
+        }
+    }
+    tree.maxDepth = max(static_cast<uint8_t>(2), min(tree.maxDepth, MAX_SCAN_DEPTH));
+
+    const std::string root = makeTempDir("boomerbox_scan_");
+    if (root.empty()) {
+        fprintf(stderr, "failed to create a temporary directory\n");
+        return 1;
+    }
+    const TreeSummary summary = generateTree(root, tree);
+    SD.setRoot(root.c_str());
+    SD.begin();
+    Serial.enabled = false;
+
+    printf("tree: %s\n", root.c_str());
+    printf("%u artists x %u albums x %u tracks, album depth up to %u: %u albums, %u files, %.1f MB\n\n",
+           tree.artists, tree.albumsPerArtist, tree.tracksPerAlbum, tree.maxDepth,
+           summary.albums, summary.files, summary.bytes / 1048576.0);
+
+    const auto removeCatalog = [] {
+        SD.remove(CATALOG_PATH);
+        SD.remove(CATALOG_ALT_PATH);
+    };
+    const auto nothing = [] {};
+    const std::string changedTrack = root + "/ART000/ALB000/T99.MP3";
+
+    PhaseResult results[4] = {
+        measure("scan (no catalog)", runs, removeCatalog, scan_songs),
+        measure("scan (catalog valid)", runs, nothing, scan_songs),
+        measure("scan (1 album changed)", runs,
+                [&] {
+                    SyntheticTags tags;
+                    tags.title = "Bonus";
+                    tags.artist = "Artist 0";
+                    tags.album = "Album 0";
+                    tags.track = 99;
+                    writeFile(changedTrack, makeMp3(tags, Mp3Options()));
+                },
+                [&] {
+                    scan_songs();
+                    // Leave the tree as it was for the next run
+                    unlink(changedTrack.c_str());
+                    scan_songs();
+                }),
+        measure("load all albums", runs, nothing, [] {
+            for (uint16_t i = 0; i < albumCount(); i++) {
+                if (loadAlbum(i)) {
+                    while (loadAlbumStep()) {
+                    }
+                }
+            }
+        }),
+    };
+
+    printf("%-22s %9s %7s %7s %8s %7s %8s %10s %7s %7s %9s\n",
+           "phase", "best ms", "dirs", "files", "dirreads", "passes", "reads", "bytes", "seeks", "writes", "calls/alb");
+    for (const PhaseResult& r : results) {
+        printResult(r, albumCount());
+    }
+    printf("\nalbums found: %u\n", albumCount());
+    printf("(\"1 album changed\" adds a track, rescans, removes it and rescans again)\n");
+
+    if (!keep) {
+        removeTree(root);
+    }
+    return 0;
+}
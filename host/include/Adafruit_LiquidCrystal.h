@@ -0,0 +1,34 @@
+// Host (native) stand-in for Adafruit_LiquidCrystal on the I2C backpack. It
+// drives the MCP23008 on the host Wire bus the way the library does, one
+// read-modify-write of the port per pin change, so its I2C traffic can be
+// counted against the batched driver in lcd.cpp. There are no delays.
+
+#ifndef BOOMERBOX_HOST_ADAFRUIT_LIQUIDCRYSTAL_H
+#define BOOMERBOX_HOST_ADAFRUIT_LIQUIDCRYSTAL_H
+
+#include <Arduino.h>
+
+class Adafruit_LiquidCrystal : public Print {
+public:
+    explicit Adafruit_LiquidCrystal(uint8_t i2cAddr);
+
+    bool begin(uint8_t cols, uint8_t rows);
+    void clear();
+    void home();
+    void setCursor(uint8_t col, uint8_t row);
+    void createChar(uint8_t location, uint8_t charmap[]);
+    void setBacklight(uint8_t value);
+    void command(uint8_t value);
+    size_t write(uint8_t value) override;
+
+private:
+    void send(uint8_t value, bool data);
+    void write4bits(uint8_t value);
+    uint8_t readGPIO();
+    void writeGPIO(uint8_t value);
+    void digitalWrite(uint8_t pin, bool value);
+
+    uint8_t _address;
+};
+
+#endif //BOOMERBOX_HOST_ADAFRUIT_LIQUIDCRYSTAL_H
@@ -0,0 +1,155 @@
+// Host (native) stand-in for the subset of the Arduino core used by the
+// library scanning and metadata parsing code. Not used on device builds.
+
+#ifndef BOOMERBOX_HOST_ARDUINO_H
+#define BOOMERBOX_HOST_ARDUINO_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <algorithm>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+using std::min;
+using std::max;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+// Single threaded: simulated interrupts run between statements, never during them
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+class String {
+public:
+    String() = default;
+    String(const char* s) : _s(s ? s : "") {}
+    String(const std::string& s) : _s(s) {}
+    explicit String(char c) : _s(1, c) {}
+    explicit String(int v) : _s(std::to_string(v)) {}
+    explicit String(unsigned int v) : _s(std::to_string(v)) {}
+    explicit String(long v) : _s(std::to_string(v)) {}
+    explicit String(unsigned long v) : _s(std::to_string(v)) {}
+    explicit String(unsigned char v) : _s(std::to_string(v)) {}
+
+    unsigned int length() const { return _s.length(); }
+    const char* c_str() const { return _s.c_str(); }
+    bool reserve(unsigned int size) { _s.reserve(size); return true; }
+
+    char operator[](unsigned int i) const { return i < _s.length() ? _s[i] : '\0'; }
+    char& operator[](unsigned int i) { return _s[i]; }
+    char charAt(unsigned int i) const { return (*this)[i]; }
+
+    String& operator+=(const String& rhs) { _s += rhs._s; return *this; }
+    String& operator+=(const char* rhs) { if (rhs) _s += rhs; return *this; }
+    String& operator+=(char c) { _s += c; return *this; }
+    bool concat(const String& rhs) { _s += rhs._s; return true; }
+    bool concat(const char* rhs) { if (rhs) _s += rhs; return true; }
+    bool concat(char c) { _s += c; return true; }
+
+    friend String operator+(const String& a, const String& b) { return String(a._s + b._s); }
+    friend String operator+(const String& a, const char* b) { return String(a._s + (b ? b : "")); }
+    friend String operator+(const char* a, const String& b) { return String((a ? a : "") + b._s); }
+    friend String operator+(const String& a, char c) { return String(a._s + c); }
+
+    bool operator==(const String& rhs) const { return _s == rhs._s; }
+    bool operator==(const char* rhs) const { return _s == (rhs ? rhs : ""); }
+    bool operator!=(const String& rhs) const { return _s != rhs._s; }
+    bool operator!=(const char* rhs) const { return !(*this == rhs); }
+    bool equals(const String& rhs) const { return _s == rhs._s; }
+    bool equalsIgnoreCase(const String& rhs) const {
+        if (_s.length() != rhs._s.length()) return false;
+        for (size_t i = 0; i < _s.length(); i++) {
+            if (tolower(static_cast<unsigned char>(_s[i])) != tolower(static_cast<unsigned char>(rhs._s[i]))) return false;
+        }
+        return true;
+    }
+    int compareTo(const String& rhs) const { return strcmp(_s.c_str(), rhs._s.c_str()); }
+
+    bool startsWith(const String& prefix) const { return _s.compare(0, prefix._s.length(), prefix._s) == 0; }
+    bool endsWith(const String& suffix) const {
+        return _s.length() >= suffix._s.length() &&
+               _s.compare(_s.length() - suffix._s.length(), suffix._s.length(), suffix._s) == 0;
+    }
+
+    int indexOf(char c, unsigned int from = 0) const {
+        const size_t pos = _s.find(c, from);
+        return pos == std::string::npos ? -1 : static_cast<int>(pos);
+    }
+    int indexOf(const String& s, unsigned int from = 0) const {
+        const size_t pos = _s.find(s._s, from);
+        return pos == std::string::npos ? -1 : static_cast<int>(pos);
+    }
+    int lastIndexOf(char c) const {
+        const size_t pos = _s.rfind(c);
+        return pos == std::string::npos ? -1 : static_cast<int>(pos);
+    }
+
+    String substring(unsigned int from) const { return from >= _s.length() ? String() : String(_s.substr(from)); }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to) std::swap(from, to);
+        if (from >= _s.length()) return String();
+        return String(_s.substr(from, to - from));
+    }
+
+    void toLowerCase() { for (char& c : _s) c = static_cast<char>(tolower(static_cast<unsigned char>(c))); }
+    void toUpperCase() { for (char& c : _s) c = static_cast<char>(toupper(static_cast<unsigned char>(c))); }
+    void trim() {
+        const size_t b = _s.find_first_not_of(" \t\r\n");
+        const size_t e = _s.find_last_not_of(" \t\r\n");
+        _s = (b == std::string::npos) ? std::string() : _s.substr(b, e - b + 1);
+    }
+    long toInt() const { return atol(_s.c_str()); }
+
+private:
+    std::string _s;
+};
+
+class Print {
+public:
+    virtual ~Print() = default;
+    virtual size_t write(uint8_t c) = 0;
+    size_t print(const char* s);
+    size_t print(const String& s) { return print(s.c_str()); }
+    size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+    size_t print(int v) { return print(String(v)); }
+    size_t print(unsigned int v) { return print(String(v)); }
+    size_t print(long v) { return print(String(v)); }
+    size_t print(unsigned long v) { return print(String(v)); }
+    size_t print(unsigned char v) { return print(String(v)); }
+    size_t print(double v);
+    template<typename T>
+    size_t println(const T& v) { const size_t n = print(v); return n + print("\n"); }
+    size_t println() { return print("\n"); }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+// Serial output goes to stdout unless silenced (benchmarks silence it)
+class HostSerial : public Print {
+public:
+    void begin(unsigned long) {}
+    explicit operator bool() const { return true; }
+    size_t write(uint8_t c) override;
+    bool enabled = true;
+};
+
+extern HostSerial Serial;
+
+#endif // BOOMERBOX_HOST_ARDUINO_H
@@ -0,0 +1,95 @@
+// Host (native) stand-in for the Arduino SD library. Files and directories
+// are served from a directory on the host filesystem, set with SD.begin().
+
+#ifndef BOOMERBOX_HOST_SD_H
+#define BOOMERBOX_HOST_SD_H
+
+#include <Arduino.h>
+#include <memory>
+
+#define FILE_READ 0x01
+#define FILE_WRITE 0x13 // read | write | create | append, like the SD library
+
+struct HostFileHandle;
+
+// I/O call counters, for benchmarks. On the device each of these calls is a
+// round trip through the SD library, so the counts matter more than host time.
+struct HostIoStats {
+    uint32_t fileOpens = 0;
+    uint32_t dirOpens = 0;
+    uint32_t dirReads = 0;    // openNextFile() calls
+    uint32_t readCalls = 0;
+    uint64_t bytesRead = 0;
+    uint32_t seekCalls = 0;
+    uint32_t writeCalls = 0;
+    uint64_t bytesWritten = 0;
+
+    void reset() { *this = HostIoStats(); }
+};
+
+extern HostIoStats host_io_stats;
+
+// If set, called after each file open (bytes 0) and read, before the caller
+// sees the result, so a simulation can let time pass while the card is busy
+extern void (*host_io_hook)(bool open, uint32_t bytes);
+
+// Tells storage.h that File::modified() exists
+#define SD_FILE_MODIFIED
+
+class File : public Stream {
+public:
+    File() = default;
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t size);
+    int read() override;
+    int read(void* buf, uint16_t nbyte);
+    int peek() override;
+    int available() override;
+    void flush();
+    bool seek(uint32_t pos);
+    uint32_t position();
+    uint32_t size();
+    void close();
+    operator bool() const;
+    char* name();
+
+    bool isDirectory();
+    // Host only: modification time in milliseconds, folded to 32 bits. The
+    // card's FAT timestamps have 2 s resolution, too coarse for benchmarks
+    // that change a directory and rescan right away.
+    uint32_t modified();
+    File openNextFile(uint8_t mode = FILE_READ);
+    void rewindDirectory();
+
+private:
+    friend class SDClass;
+    std::shared_ptr<HostFileHandle> _h;
+};
+
+class SDClass {
+public:
+    // On the host, the chip select argument is ignored; the card is mapped
+    // to the directory named by the BOOMERBOX_SD_ROOT environment variable,
+    // or to the directory passed to setRoot().
+    bool begin(uint8_t csPin = 0);
+    void setRoot(const char* hostPath);
+
+    File open(const char* path, uint8_t mode = FILE_READ);
+    File open(const String& path, uint8_t mode = FILE_READ) { return open(path.c_str(), mode); }
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool mkdir(const char* path);
+    bool remove(const char* path);
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool rmdir(const char* path);
+
+private:
+    friend class File;
+    std::string hostPath(const char* path) const;
+    std::string _root;
+};
+
+extern SDClass SD;
+
+#endif // BOOMERBOX_HOST_SD_H
@@ -0,0 +1,58 @@
+// Host (native) stand-in for the Arduino Wire library, with the one device the
+// player has on its I2C bus: the LCD backpack, an MCP23008 at 0x20 whose GPIO
+// port drives an HD44780 in 4-bit mode (RS GP1, E GP2, D4-D7 GP3-GP6,
+// backlight GP7). The HD44780 is modelled from the strobes on the port, so
+// benchmarks can check what ends up on the screen.
+
+#ifndef BOOMERBOX_HOST_WIRE_H
+#define BOOMERBOX_HOST_WIRE_H
+
+#include <Arduino.h>
+#include <vector>
+
+// Bus traffic counters, for benchmarks. On the device every transaction costs
+// a start, an address byte and a stop on top of its data bytes.
+struct HostI2cStats {
+    uint32_t transactions = 0;
+    uint32_t bytes = 0;       // data bytes either way, register addresses included
+
+    void reset() { *this = HostI2cStats(); }
+};
+
+extern HostI2cStats host_i2c_stats;
+
+class TwoWire {
+public:
+    // As big as the SAMD and RP2040 cores' buffers
+    TwoWire() {
+        _tx.reserve(256);
+        _rx.reserve(256);
+    }
+
+    void begin() {}
+    void setClock(uint32_t) {}
+
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t value);
+    // Nonzero if nothing answered at the address
+    uint8_t endTransmission(bool stop = true);
+
+    uint8_t requestFrom(uint8_t address, uint8_t count);
+    int available();
+    int read();
+
+private:
+    uint8_t _address = 0;
+    std::vector<uint8_t> _tx;
+    std::vector<uint8_t> _rx;
+};
+
+extern TwoWire Wire;
+
+// The character shown at row, col of a 20x4 display
+char host_lcd_at(uint8_t row, uint8_t col);
+
+// Glyph stored in CGRAM slot (0-7) as its 8 rows
+const uint8_t* host_lcd_glyph(uint8_t slot);
+
+#endif //BOOMERBOX_HOST_WIRE_H
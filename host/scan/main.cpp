@@ -0,0 +1,63 @@
+// Native build entry point: runs the album scan (and optionally loads every
+// album) against a music tree on the host, e.g.
+//
+//   pio run -e native
+//   .pio/build/native/program /media/sdcard --load
+
+#include <Arduino.h>
+#include <SD.h>
+#include <library.h>
+#include <cstdio>
+
+int main(int argc, char** argv) {
+    const char* root = nullptr;
+    bool loadAll = false;
+    bool quiet = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--load") == 0) {
+            loadAll = true;
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else {
+            root = argv[i];
+        }
+    }
+
+    if (root) {
+        SD.setRoot(root);
+    }
+    if (!SD.begin()) {
+        fprintf(stderr, "usage: %s [--load] [--quiet] <music directory>\n", argv[0]);
+        return 1;
+    }
+
+    Serial.enabled = !quiet;
+
+    const unsigned long scanStart = micros();
+    scan_songs();
+    const unsigned long scanTime = micros() - scanStart;
+
+    unsigned long loadTime = 0;
+    if (loadAll) {
+        const unsigned long loadStart = micros();
+        for (uint16_t i = 0; i < albumCount(); i++) {
+            if (loadAlbum(i)) {
+                while (loadAlbumStep()) {
+                }
+            }
+        }
+        loadTime = micros() - loadStart;
+    }
+
+    for (uint16_t i = 0; i < albumCount(); i++) {
+        const Album* album = albumAt(i);
+        printf("%s - %s (%s)\n", album->artist, album->title, album->path);
+    }
+    printf("%u albums, scan %.1f ms", albumCount(), scanTime / 1000.0);
+    if (loadAll) {
+        printf(", load all %.1f ms", loadTime / 1000.0);
+    }
+    printf("\n");
+    return 0;
+}
@@ -0,0 +1,548 @@
+// Playback simulation: plays a generated album through a model of the VS1053
+// stream buffer and measures the silence between tracks and inside them, for
+// the previous approach (the FilePlayer reading 32 bytes from the card per
+// DREQ, and reopening the next file once it reports stopped()) and for
+// AudioFeeder with its read-ahead ring and the next track queued.
+//
+// Time is simulated. The decoder consumes its 2 KB buffer at each track's
+// bitrate and raises DREQ while 32 bytes are free; SD opens and reads cost
+// the time given on the command line, during which the decoder keeps
+// playing. Card reads made from loop() are interrupted by DREQ, reads made
+// from the interrupt are not. --spike-ms adds a latency spike (wear
+// levelling, a slow sector) to one read every --spike-every-ms. A new MP3 or
+// Ogg stream costs --resync-ms of silence while the decoder finds its first
+// frame (a WAV header is parsed as it arrives). The previous approach starts
+// a new stream for every track, as startPlayingFile() resets the decoder;
+// AudioFeeder only after an end fill and cancel, and not between MP3 tracks,
+// which it splices into one stream.
+//
+// It then plays a few queueing corner cases (tracks shorter than the ring,
+// a track queued again after the current file has been read to its end) and
+// checks that every byte reaches the decoder and playback ends.
+//
+//   pio run -e sim_gapless
+//   .pio/build/sim_gapless/program [--tracks N] [--format mp3|ogg|wav|mixed] [--loop-ms M]
+//                                  [--open-ms O] [--read-kbps R] [--spike-ms S]
+//                                  [--spike-every-ms E] [--resync-ms Y] [--poll] [--keep]
+
+#include <Arduino.h>
+#include <SD.h>
+#include <audio_feeder.h>
+#include "../bench/synthetic_media.h"
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <vector>
+
+struct SimOptions {
+    uint16_t tracks = 6;
+    const char* format = "mp3";  // mp3, ogg, wav, or mixed to cycle through all three
+    double loopMs = 30.0;        // one pass of loop() (mostly LCD updates)
+    double openMs = 5.0;         // SD.open() including the directory search
+    double readKbps = 4000.0;    // SD read throughput
+    double spikeMs = 0;          // extra latency of an occasional read
+    double spikeEveryMs = 500;
+    double resyncMs = 26.1;      // MP3 and Ogg: one MP3 frame at 44.1 kHz
+    bool interrupt = true;       // feed from DREQ, not only from loop()
+};
+
+static SimOptions options;
+
+// Simulated time in microseconds
+static double now_us = 0;
+
+static constexpr uint16_t DECODER_BUFFER = 2048;
+static constexpr double TICK_US = 100;
+// End fill bytes are not decoded, the VS1053 discards them quickly
+static constexpr double FILL_BYTES_PER_US = 1.0;
+
+struct Segment {
+    int track;          // -1 for fill bytes
+    double bytes;
+    double bytesPerUs;
+    double holdUs;      // silence before the bytes, while the decoder resyncs
+};
+
+struct TrackTimes {
+    double firstAudio = -1;
+    double lastAudio = -1;
+    double audioUs = 0;     // time spent playing this track's data
+};
+
+class SimDecoder : public AudioOutput {
+public:
+    std::vector<TrackTimes> times;
+    std::vector<double> trackRates;
+    std::vector<bool> trackFramed;  // MP3 or Ogg, so a new stream has to sync
+    uint64_t audioBytes = 0;    // sent, end fill bytes aside
+    int sendingTrack = 0;       // track the next audio bytes belong to
+    const AudioFeeder* feeder = nullptr; // if set, its advances() give the track
+
+    bool readyForData() override { return level() + 32 <= DECODER_BUFFER; }
+
+    void playData(uint8_t* /*data*/, const uint8_t length) override {
+        if (feeder) sendingTrack = feeder->advances();
+        const bool fill = _filling;
+        const double rate = fill ? FILL_BYTES_PER_US : trackRates[sendingTrack];
+        const int track = fill ? -1 : sendingTrack;
+        if (!fill) audioBytes += length;
+        if (_resync && !fill) {
+            // The decoder syncs on the new stream's first bytes
+            _resync = false;
+            if (static_cast<size_t>(track) < trackFramed.size() && trackFramed[track]) {
+                _fifo.push_back({-1, 0, 1.0, options.resyncMs * 1000.0});
+            }
+        }
+        if (!_fifo.empty() && _fifo.back().track == track) {
+            _fifo.back().bytes += length;
+        } else {
+            _fifo.push_back({track, static_cast<double>(length), rate, 0});
+        }
+        if (_cancelBytes >= 0) _cancelBytes -= length;
+    }
+
+    void beginStream() override {
+        _filling = false;
+        _resync = true;
+    }
+
+    uint8_t endFillByte() override {
+        _filling = true;
+        return 0;
+    }
+
+    void requestCancel() override { _cancelBytes = level() + 32; }
+
+    bool cancelPending() override {
+        // Cancelled once everything sent before the request has been consumed
+        if (_cancelBytes >= 0 && _consumedSinceCancel >= _cancelBytes) {
+            _cancelBytes = -1;
+            _consumedSinceCancel = 0;
+        }
+        return _cancelBytes >= 0;
+    }
+
+    // Legacy FilePlayer path: a new file is sent without end fill or cancel,
+    // after startPlayingFile() has reset the decoder's stream state
+    void continueStream() {
+        _filling = false;
+        _resync = true;
+    }
+
+    void advance(double us) {
+        double t = now_us;
+        while (us > 0) {
+            if (_fifo.empty()) break;
+            Segment& seg = _fifo.front();
+            if (seg.holdUs > 0) {
+                const double held = seg.holdUs < us ? seg.holdUs : us;
+                seg.holdUs -= held;
+                t += held;
+                us -= held;
+                continue;
+            }
+            const double needed = seg.bytes / seg.bytesPerUs;
+            const double used = needed < us ? needed : us;
+            const double bytes = used * seg.bytesPerUs;
+            if (seg.track >= 0) {
+                TrackTimes& tt = times[seg.track];
+                if (tt.firstAudio < 0) tt.firstAudio = t;
+                tt.lastAudio = t + used;
+                tt.audioUs += used;
+            }
+            seg.bytes -= bytes;
+            if (_cancelBytes >= 0) _consumedSinceCancel += bytes;
+            t += used;
+            us -= used;
+            if (seg.bytes <= 1e-6) _fifo.pop_front();
+        }
+    }
+
+    double level() const {
+        double total = 0;
+        for (const Segment& seg : _fifo) total += seg.bytes;
+        return total;
+    }
+
+private:
+    std::deque<Segment> _fifo;
+    bool _filling = false;
+    bool _resync = false;       // the next audio bytes start a new stream
+    double _cancelBytes = -1;
+    double _consumedSinceCancel = 0;
+};
+
+static SimDecoder decoder;
+// Fed on DREQ while loop() waits on the card
+static AudioFeeder* interrupt_feeder = nullptr;
+static double next_spike_us = 0;
+
+static void tick() {
+    decoder.advance(TICK_US);
+    now_us += TICK_US;
+    if (interrupt_feeder && options.interrupt) interrupt_feeder->feed();
+}
+
+// Let the time an SD call takes pass (host_io_hook)
+static void chargeIo(const bool open, const uint32_t bytes) {
+    double us = open ? options.openMs * 1000.0 : bytes * 1e6 / (options.readKbps * 1024.0);
+    if (!open && options.spikeMs > 0 && now_us >= next_spike_us) {
+        us += options.spikeMs * 1000.0;
+        next_spike_us = now_us + options.spikeEveryMs * 1000.0;
+    }
+    const double end = now_us + us;
+    while (now_us + TICK_US <= end) tick();
+    decoder.advance(end - now_us);
+    now_us = end;
+}
+
+// ============================================================================
+// PREVIOUS: Adafruit_VS1053_FilePlayer, next file opened after stopped()
+// ============================================================================
+
+class LegacyPlayer {
+public:
+    bool startPlayingFile(const char* path) {
+        _track = SD.open(path);
+        if (!_track) return false;
+        // mp3_ID3Jumper()
+        uint8_t header[10];
+        if (_track.read(header, sizeof(header)) == sizeof(header) && memcmp(header, "ID3", 3) == 0) {
+            const uint32_t size = ((header[6] & 0x7F) << 21) | ((header[7] & 0x7F) << 14) |
+                                  ((header[8] & 0x7F) << 7) | (header[9] & 0x7F);
+            _track.seek(size + 10);
+        } else {
+            _track.seek(0);
+        }
+        _playing = true;
+        feedBuffer();
+        return true;
+    }
+
+    void feedBuffer() {
+        while (_playing && decoder.readyForData()) {
+            uint8_t buffer[32];
+            const int n = _track.read(buffer, sizeof(buffer));
+            if (n <= 0) {
+                _playing = false;
+                _track.close();
+                break;
+            }
+            decoder.playData(buffer, n);
+        }
+    }
+
+    bool stopped() const { return !_playing; }
+
+private:
+    File _track;
+    bool _playing = false;
+};
+
+static void runLegacy(const std::vector<std::string>& paths) {
+    LegacyPlayer player;
+    size_t index = 0;
+    decoder.sendingTrack = 0;
+    player.startPlayingFile(paths[0].c_str());
+
+    double nextLoop = now_us;
+    double blockedUntil = 0;
+    while (true) {
+        if (options.interrupt) {
+            player.feedBuffer();
+        }
+        if (now_us >= nextLoop && now_us >= blockedUntil) {
+            if (!options.interrupt) {
+                player.feedBuffer();
+            }
+            if (player.stopped()) {
+                if (++index >= paths.size()) break;
+                decoder.sendingTrack = index;
+                decoder.continueStream();
+                player.startPlayingFile(paths[index].c_str());
+                // delay(50) in play_next_song()
+                blockedUntil = now_us + 50000;
+            }
+            nextLoop = now_us + options.loopMs * 1000.0;
+        }
+        tick();
+    }
+    // Play out the buffer
+    decoder.advance(1e7);
+}
+
+// ============================================================================
+// AUDIOFEEDER: read-ahead ring, next file queued while the current one plays
+// ============================================================================
+
+static uint16_t runFeeder(const std::vector<std::string>& paths) {
+    AudioFeeder feeder(decoder);
+    size_t index = 0;
+    uint16_t seen = 0;
+
+    decoder.feeder = &feeder;
+    interrupt_feeder = &feeder;
+    feeder.play(paths[0].c_str());
+    if (paths.size() > 1) feeder.queue(paths[1].c_str());
+    const uint16_t underruns = feeder.underruns();
+
+    double nextLoop = now_us;
+    while (feeder.playing()) {
+        if (now_us >= nextLoop) {
+            // AudioCore::service()
+            if (!options.interrupt) feeder.feed();
+            feeder.fill();
+            if (!options.interrupt) feeder.feed();
+            if (feeder.advances() != seen) {
+                seen++;
+                index++;
+                if (index + 1 < paths.size()) {
+                    feeder.queue(paths[index + 1].c_str());
+                }
+            }
+            nextLoop = now_us + options.loopMs * 1000.0;
+        }
+        tick();
+    }
+    interrupt_feeder = nullptr;
+    decoder.advance(1e7);
+    decoder.feeder = nullptr;
+    return feeder.underruns() - underruns;
+}
+
+// ============================================================================
+// QUEUEING CORNER CASES
+// ============================================================================
+
+struct QueueCase {
+    const char* name;
+    std::vector<uint32_t> sizes;  // bytes per track
+    bool requeue;                 // clearQueue() and queue() the next track again, as after sorting
+};
+
+// Plays the tracks as the player does: the next track queued after play()
+// and on every advance. Returns false if a byte went missing or playback
+// did not end.
+static bool runQueueCase(const std::string& root, const QueueCase& queueCase, const char* extension) {
+    std::vector<std::string> paths;
+    uint64_t total = 0;
+    for (size_t i = 0; i < queueCase.sizes.size(); i++) {
+        // No ID3 tag, so the whole file is sent
+        const std::string name = "/Q" + std::to_string(i + 1) + extension;
+        writeFile(root + name, std::string(queueCase.sizes[i], '\x55'));
+        paths.push_back(name);
+        total += queueCase.sizes[i];
+    }
+    // 128 kbps
+    decoder.times.assign(paths.size(), TrackTimes());
+    decoder.trackRates.assign(paths.size(), 128000.0 / 8 / 1e6);
+    const double limitUs = now_us + total / decoder.trackRates[0] + 5e6;
+
+    AudioFeeder feeder(decoder);
+    decoder.feeder = &feeder;
+    interrupt_feeder = &feeder;
+    feeder.play(paths[0].c_str());
+    feeder.queue(paths[1].c_str());
+    if (queueCase.requeue) {
+        feeder.clearQueue();
+        feeder.queue(paths[1].c_str());
+    }
+
+    size_t index = 0;
+    uint16_t seen = 0;
+    double nextLoop = now_us;
+    while (feeder.playing() && now_us < limitUs) {
+        if (now_us >= nextLoop) {
+            feeder.fill();
+            if (!options.interrupt) {
+                feeder.feed();
+            }
+            if (feeder.advances() != seen) {
+                seen++;
+                index++;
+                if (index + 1 < paths.size()) feeder.queue(paths[index + 1].c_str());
+            }
+            nextLoop = now_us + options.loopMs * 1000.0;
+        }
+        tick();
+    }
+    const bool ended = !feeder.playing();
+    feeder.stop();
+    interrupt_feeder = nullptr;
+    decoder.feeder = nullptr;
+
+    const bool ok = ended && decoder.audioBytes == total;
+    printf("  %-36s %s  %8llu of %8llu bytes sent, %s%s\n", queueCase.name, extension,
+           static_cast<unsigned long long>(decoder.audioBytes), static_cast<unsigned long long>(total),
+           ended ? "ended" : "still playing", ok ? "" : "  FAIL");
+    return ok;
+}
+
+// ============================================================================
+
+struct Report {
+    double maxGapMs = 0;
+    double totalGapMs = 0;
+    double underrunMs = 0;
+};
+
+static Report report(const char* name, const std::vector<std::string>& paths) {
+    Report r;
+    printf("%s\n", name);
+    for (size_t i = 0; i + 1 < paths.size(); i++) {
+        const double gap = (decoder.times[i + 1].firstAudio - decoder.times[i].lastAudio) / 1000.0;
+        printf("  %zu -> %zu  gap %8.2f ms\n", i + 1, i + 2, gap);
+        if (gap > r.maxGapMs) r.maxGapMs = gap;
+        r.totalGapMs += gap;
+    }
+    // Silence inside a track
+    for (const TrackTimes& tt : decoder.times) {
+        const double silence = tt.lastAudio - tt.firstAudio - tt.audioUs;
+        if (silence > 0) r.underrunMs += silence / 1000.0;
+    }
+    printf("  max gap %.2f ms, mean gap %.2f ms, mid-track underruns %.2f ms\n\n",
+           r.maxGapMs, paths.size() > 1 ? r.totalGapMs / (paths.size() - 1) : 0.0, r.underrunMs);
+    return r;
+}
+
+static void resetSimulation(const std::vector<double>& rates, const std::vector<bool>& framed) {
+    decoder = SimDecoder();
+    decoder.times.assign(rates.size(), TrackTimes());
+    decoder.trackRates = rates;
+    decoder.trackFramed = framed;
+    now_us = 0;
+    next_spike_us = options.spikeEveryMs * 1000.0;
+    host_io_stats.reset();
+}
+
+int main(int argc, char** argv) {
+    bool keep = false;
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--tracks") == 0 && hasValue) {
+            options.tracks = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--format") == 0 && hasValue) {
+            options.format = argv[++i];
+        } else if (strcmp(argv[i], "--loop-ms") == 0 && hasValue) {
+            options.loopMs = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--open-ms") == 0 && hasValue) {
+            options.openMs = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--read-kbps") == 0 && hasValue) {
+            options.readKbps = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--spike-ms") == 0 && hasValue) {
+            options.spikeMs = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--spike-every-ms") == 0 && hasValue) {
+            options.spikeEveryMs = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--resync-ms") == 0 && hasValue) {
+            options.resyncMs = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--poll") == 0) {
+            options.interrupt = false;
+        } else if (strcmp(argv[i], "--keep") == 0) {
+            keep = true;
+        } else {
+            printf("usage: %s [--tracks N] [--format mp3|ogg|wav|mixed] [--loop-ms M] [--open-ms O]\n"
+                   "          [--read-kbps R] [--spike-ms S] [--spike-every-ms E] [--resync-ms Y]\n"
+                   "          [--poll] [--keep]\n",
+                   argv[0]);
+            return 1;
+        }
+    }
+    if (options.tracks < 2) options.tracks = 2;
+
+    const std::string root = makeTempDir("boomerbox-gapless");
+    SD.setRoot(root.c_str());
+    Serial.enabled = false;
+    host_io_hook = chargeIo;
+
+    // About 3 seconds per track
+    std::vector<std::string> paths;
+    std::vector<double> rates;
+    std::vector<bool> framed;
+    for (uint16_t i = 0; i < options.tracks; i++) {
+        SyntheticTags tags;
+        tags.title = "Track " + std::to_string(i + 1);
+        tags.artist = "Artist";
+        tags.album = "Album";
+        tags.track = i + 1;
+        const int format = strcmp(options.format, "mixed") == 0 ? i % 3
+                           : strcmp(options.format, "ogg") == 0 ? 1
+                           : strcmp(options.format, "wav") == 0 ? 2 : 0;
+        std::string name = "/T" + std::to_string(i + 1);
+        std::string data;
+        if (format == 0) {
+            Mp3Options mp3;
+            mp3.frames = 115;
+            data = makeMp3(tags, mp3);
+            name += ".MP3";
+            rates.push_back(128000.0 / 8 / 1e6);
+        } else if (format == 1) {
+            OggOptions ogg;
+            ogg.pages = 14;
+            data = makeOgg(tags, ogg);
+            name += ".OGG";
+            // Whatever the generated size, play it in 3 seconds
+            rates.push_back(data.size() / 3e6);
+        } else {
+            WavOptions wav;
+            wav.dataBytes = 44100 * 4 * 3;
+            data = makeWav(tags, wav);
+            name += ".WAV";
+            rates.push_back(44100.0 * 4 / 1e6);
+        }
+        writeFile(root + name, data);
+        paths.push_back(name);
+        framed.push_back(format != 2);
+    }
+
+    printf("%u %s tracks, loop %.1f ms, open %.1f ms, SD %.0f KB/s, resync %.1f ms, %s feeding\n",
+           options.tracks, options.format, options.loopMs, options.openMs, options.readKbps,
+           options.resyncMs, options.interrupt ? "DREQ interrupt" : "loop()");
+    if (options.spikeMs > 0) {
+        printf("read latency spike of %.1f ms every %.0f ms\n", options.spikeMs, options.spikeEveryMs);
+    }
+    printf("\n");
+
+    resetSimulation(rates, framed);
+    runLegacy(paths);
+    const Report legacy = report("reopen after stopped() (previous)", paths);
+
+    resetSimulation(rates, framed);
+    const uint16_t underruns = runFeeder(paths);
+    const Report feeder = report("AudioFeeder with read-ahead and the next track queued", paths);
+    printf("  ring underruns counted by the feeder: %u\n", underruns);
+    // How long the ring lasts at the album's highest bitrate, against the
+    // longest wait for fill() in this run
+    double maxRate = 0;
+    for (const double rate : rates) maxRate = rate > maxRate ? rate : maxRate;
+    const double ringMs = AudioFeeder::RING_SIZE / maxRate / 1000.0;
+    const double waitMs = options.spikeMs + options.loopMs;
+    printf("  ring of %u bytes lasts %.0f ms at the highest bitrate, against a wait of up to %.0f ms%s\n",
+           AudioFeeder::RING_SIZE, ringMs, waitMs, waitMs > ringMs ? ": expect underruns" : "");
+    if (!options.interrupt) {
+        // The previous approach sends the next file straight after the last,
+        // with no end fill or cancel, so it has nothing to wait for
+        printf("  fed from loop(): each step of an end fill and cancel waits for the next pass\n");
+    }
+    printf("\n");
+
+    printf("max gap: %.2f ms -> %.2f ms\n", legacy.maxGapMs, feeder.maxGapMs);
+    printf("mid-track underruns: %.2f ms -> %.2f ms\n", legacy.underrunMs, feeder.underrunMs);
+
+    // Each case is shorter than the ring somewhere
+    const std::vector<QueueCase> queueCases = {
+        {"short first track", {10000, 50000}, false},
+        {"after a fully read short track", {60000, 10000, 50000}, false},
+        {"queued again after the file ended", {10000, 70000}, true},
+    };
+    printf("\nqueueing\n");
+    uint8_t failures = 0;
+    for (const QueueCase& queueCase : queueCases) {
+        for (const char* extension : {".MP3", ".WAV"}) {
+            resetSimulation(std::vector<double>(), std::vector<bool>());
+            if (!runQueueCase(root, queueCase, extension)) failures++;
+        }
+    }
+
+    if (!keep) removeTree(root);
+    return failures == 0 ? 0 : 2;
+}
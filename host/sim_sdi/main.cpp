@@ -0,0 +1,435 @@
+// Bus simulation of the DMA stream path: plays a generated album through
+// AudioFeeder twice, once sending stream data from the CPU (Vs1053Output) and
+// once in DMA bursts through SdiScheduler (Vs1053DmaOutput), and reports the
+// CPU time spent feeding the decoder and any silence.
+//
+// Time is simulated in 1 us steps. The SPI bus is shared: card access holds
+// it (storage_bus, as on the device) for the time the open or read takes,
+// and the VS1053 accepts 32 bytes at a time while DREQ is high. DREQ
+// interrupts fire on each edge, as attachInterrupt(CHANGE) does, and are held
+// while the card has the bus, as SPI.usingInterrupt() does; the DMA
+// completion interrupt fires when a burst has been clocked out.
+//
+// Along the way it checks what the scheduler promises: no burst starts while
+// the card has the bus, with DREQ low or with another in flight, the card
+// never gets the bus during a burst, register access never happens during a
+// burst, and the decoder buffer never overflows. Any violation fails the run.
+//
+//   pio run -e sim_sdi
+//   .pio/build/sim_sdi/program [--tracks N] [--format mp3|wav] [--loop-ms M] [--open-ms O]
+//                              [--read-kbps R] [--spi-mhz S] [--keep]
+
+#include <Arduino.h>
+#include <SD.h>
+#include <audio_feeder.h>
+#include <sdi_scheduler.h>
+#include <storage.h>
+#include "../bench/synthetic_media.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct SimOptions {
+    uint16_t tracks = 4;
+    const char* format = "mp3";
+    double loopMs = 30.0;        // one pass of loop()
+    double openMs = 5.0;         // opening a file, including the directory search
+    double readKbps = 4000.0;    // card read throughput
+    double spiMhz = 8.0;         // SDI clock (VS1053_DATA_SPI_SETTING)
+};
+
+static SimOptions options;
+
+static constexpr uint16_t DECODER_BUFFER = 2048;
+// CPU cost of sending a 32-byte chunk by hand, on top of the bytes themselves:
+// the SPI transaction and chip select
+static constexpr double CPU_CHUNK_OVERHEAD_US = 4.0;
+// CPU cost of starting a DMA burst (copy and channel setup), and of its
+// completion interrupt (entry, draining the SPI peripheral, deselecting)
+static constexpr double DMA_START_US = 3.0;
+static constexpr double DMA_COMPLETE_US = 3.0;
+// End fill bytes are not decoded, the VS1053 discards them quickly
+static constexpr double FILL_BYTES_PER_US = 1.0;
+
+// Simulated time in microseconds
+static double now_us = 0;
+static uint32_t violations = 0;
+
+static void violation(const char* what) {
+    if (violations++ < 10) printf("  VIOLATION at %.3f ms: %s\n", now_us / 1000.0, what);
+}
+
+// Decoder stream buffer, consumed at the track's byte rate
+struct SimDecoder {
+    double level = 0;
+    double fillLevel = 0;      // end fill bytes at the back of the buffer
+    double bytesPerUs = 0;
+    bool started = false;
+    double silenceUs = 0;
+    bool cancelling = false;
+    double cancelBytes = 0;    // still to be consumed before the cancel completes
+
+    bool dreq() const { return level + 32 <= DECODER_BUFFER; }
+
+    void receive(const uint8_t length, const bool fill) {
+        level += length;
+        if (fill) fillLevel += length;
+        if (level > DECODER_BUFFER) violation("decoder buffer overflow");
+        started = true;
+    }
+
+    // Audio is played at the track's rate, then the end fill is discarded
+    void advance(double us, const bool playing) {
+        while (us > 0) {
+            const double audio = level - fillLevel;
+            double bytes;
+            if (audio > 0) {
+                const double t = audio / bytesPerUs < us ? audio / bytesPerUs : us;
+                bytes = t * bytesPerUs;
+                us -= t;
+            } else if (fillLevel > 0) {
+                const double t = fillLevel / FILL_BYTES_PER_US < us ? fillLevel / FILL_BYTES_PER_US : us;
+                bytes = t * FILL_BYTES_PER_US;
+                fillLevel -= bytes;
+                us -= t;
+            } else {
+                if (playing && started) silenceUs += us;
+                break;
+            }
+            level -= bytes;
+            if (level < 1e-9) level = fillLevel = 0;
+            if (cancelling) cancelBytes -= bytes;
+        }
+    }
+};
+
+static SimDecoder decoder;
+static AudioFeeder* active_feeder = nullptr;
+static bool card_on_bus = false;
+static bool dreq_latched = false;   // edge seen while the interrupt was held
+static bool last_dreq = false;
+static double cpu_feed_us = 0;      // spent sending stream data, either way
+static double bus_wait_us = 0;      // card waiting out a burst
+
+// Time passing with the CPU busy: the decoder keeps playing, nothing else runs
+static void spend(const double us) {
+    decoder.advance(us, active_feeder && active_feeder->playing());
+    now_us += us;
+}
+
+// ============================================================================
+// CPU: Vs1053Output, every byte written by the CPU
+// ============================================================================
+
+class SimCpuOutput : public AudioOutput {
+public:
+    bool readyForData() override { return decoder.dreq(); }
+
+    void playData(uint8_t* /*data*/, const uint8_t length) override {
+        if (card_on_bus) violation("stream data sent while the card has the bus");
+        const double us = CPU_CHUNK_OVERHEAD_US + length * 8 / options.spiMhz;
+        cpu_feed_us += us;
+        spend(us);
+        decoder.receive(length, _filling);
+    }
+
+    void beginStream() override { _filling = false; }
+
+    uint8_t endFillByte() override {
+        _filling = true;
+        return 0;
+    }
+
+    void requestCancel() override {
+        decoder.cancelling = true;
+        decoder.cancelBytes = decoder.level;
+    }
+
+    bool cancelPending() override {
+        if (decoder.cancelling && decoder.cancelBytes <= 0) decoder.cancelling = false;
+        return decoder.cancelling;
+    }
+
+protected:
+    bool _filling = false;
+};
+
+// ============================================================================
+// DMA: Vs1053DmaOutput over a model of the DMA channel
+// ============================================================================
+
+class SimDmaPort : public SdiPort {
+public:
+    bool dreq() override { return decoder.dreq(); }
+
+    void startBurst(const uint8_t* /*data*/, const uint8_t length) override {
+        if (card_on_bus) violation("burst started while the card has the bus");
+        if (!decoder.dreq()) violation("burst started with DREQ low");
+        if (_inFlight) violation("burst started with another in flight");
+        _inFlight = true;
+        _length = length;
+        _doneAt = now_us + length * 8 / options.spiMhz;
+        cpu_feed_us += DMA_START_US;
+        spend(DMA_START_US);
+    }
+
+    // Polling costs a little time, so finish() makes progress
+    bool burstBusy() override {
+        if (now_us < _doneAt) {
+            spend(1);
+            return true;
+        }
+        return false;
+    }
+
+    void endBurst() override {
+        _inFlight = false;
+        decoder.receive(_length, filling);
+    }
+
+    bool inFlight() const { return _inFlight; }
+    // Clocked out; the DMA interrupt is due
+    bool due() const { return _inFlight && now_us >= _doneAt; }
+
+    bool filling = false;
+
+private:
+    bool _inFlight = false;
+    uint8_t _length = 0;
+    double _doneAt = 0;
+};
+
+static SimDmaPort dma_port;
+static SdiScheduler* sdi = nullptr;
+static bool use_dma = false;
+
+class SimDmaOutput : public SimCpuOutput {
+public:
+    bool readyForData() override { return sdi->ready(); }
+
+    void playData(uint8_t* data, const uint8_t length) override {
+        dma_port.filling = _filling;
+        sdi->send(data, length);
+    }
+
+    void beginStream() override {
+        registerAccess();
+        SimCpuOutput::beginStream();
+    }
+
+    uint8_t endFillByte() override {
+        registerAccess();
+        return SimCpuOutput::endFillByte();
+    }
+
+    void requestCancel() override {
+        registerAccess();
+        SimCpuOutput::requestCancel();
+    }
+
+    bool cancelPending() override {
+        registerAccess();
+        return SimCpuOutput::cancelPending();
+    }
+
+private:
+    static void registerAccess() {
+        sdi->finish();
+        if (dma_port.inFlight()) violation("register access during a burst");
+    }
+};
+
+// ============================================================================
+
+static void feed_audio() {
+    if (active_feeder) active_feeder->feed();
+}
+
+static void dma_done() {
+    cpu_feed_us += DMA_COMPLETE_US;
+    spend(DMA_COMPLETE_US);
+    sdi->complete();
+}
+
+// One microsecond of loop() waiting (or working); interrupts run
+static void tick() {
+    spend(1);
+    if (use_dma && dma_port.due()) dma_done();
+
+    const bool dreq = decoder.dreq();
+    if (dreq != last_dreq) {
+        last_dreq = dreq;
+        dreq_latched = true;
+    }
+    if (dreq_latched && !card_on_bus) {
+        dreq_latched = false;
+        feed_audio();
+    }
+}
+
+static void claimBus() {
+    if (use_dma) {
+        const double start = now_us;
+        sdi->claimBus();
+        bus_wait_us += now_us - start;
+        if (dma_port.inFlight()) violation("card got the bus during a burst");
+    }
+    card_on_bus = true;
+}
+
+static void releaseBus() {
+    card_on_bus = false;
+    if (use_dma) sdi->releaseBus();
+}
+
+// Let the time a card call takes pass, with the bus held (host_io_hook)
+static void chargeIo(const bool open, const uint32_t bytes) {
+    if (!card_on_bus) violation("card access without the bus");
+    const double end = now_us + (open ? options.openMs * 1000.0 : bytes * 1e6 / (options.readKbps * 1024.0));
+    while (now_us < end) tick();
+}
+
+struct Result {
+    double playUs = 0;
+    double cpuFeedUs = 0;
+    double busWaitUs = 0;
+    double silenceUs = 0;
+    uint32_t bursts = 0;
+    uint16_t underruns = 0;
+};
+
+static Result run(const std::vector<std::string>& paths, const bool dma) {
+    decoder = SimDecoder();
+    decoder.bytesPerUs = strcmp(options.format, "wav") == 0 ? 44100.0 * 4 / 1e6 : 128000.0 / 8 / 1e6;
+    now_us = 0;
+    card_on_bus = false;
+    dreq_latched = false;
+    last_dreq = decoder.dreq();
+    cpu_feed_us = 0;
+    bus_wait_us = 0;
+    use_dma = dma;
+    SdiScheduler scheduler(dma_port);
+    scheduler.onIdle(feed_audio);
+    sdi = &scheduler;
+
+    SimCpuOutput cpuOutput;
+    SimDmaOutput dmaOutput;
+    AudioFeeder feeder(dma ? static_cast<AudioOutput&>(dmaOutput) : cpuOutput);
+    active_feeder = &feeder;
+
+    size_t index = 0;
+    uint16_t seen = 0;
+    feeder.play(paths[0].c_str());
+    if (paths.size() > 1) feeder.queue(paths[1].c_str());
+
+    double nextLoop = now_us;
+    while (feeder.playing()) {
+        if (now_us >= nextLoop) {
+            feeder.fill();
+            feeder.feed();
+            if (feeder.advances() != seen) {
+                seen++;
+                index++;
+                if (index + 1 < paths.size()) feeder.queue(paths[index + 1].c_str());
+            }
+            nextLoop = now_us + options.loopMs * 1000.0;
+        }
+        tick();
+    }
+    active_feeder = nullptr;
+    sdi = nullptr;
+
+    Result r;
+    r.playUs = now_us;
+    r.cpuFeedUs = cpu_feed_us;
+    r.busWaitUs = bus_wait_us;
+    r.silenceUs = decoder.silenceUs;
+    r.bursts = dma ? scheduler.bursts() : 0;
+    r.underruns = feeder.underruns();
+    return r;
+}
+
+static void report(const char* name, const Result& r) {
+    printf("%s\n", name);
+    printf("  played %.2f s, feeding took %.1f ms of CPU (%.2f%%)\n",
+           r.playUs / 1e6, r.cpuFeedUs / 1000.0, 100.0 * r.cpuFeedUs / r.playUs);
+    if (r.bursts) {
+        printf("  %u bursts, card waited %.2f ms for the bus in all\n", r.bursts, r.busWaitUs / 1000.0);
+    }
+    printf("  silence %.2f ms, ring underruns %u\n\n", r.silenceUs / 1000.0, r.underruns);
+}
+
+int main(int argc, char** argv) {
+    bool keep = false;
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--tracks") == 0 && hasValue) {
+            options.tracks = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--format") == 0 && hasValue) {
+            options.format = argv[++i];
+        } else if (strcmp(argv[i], "--loop-ms") == 0 && hasValue) {
+            options.loopMs = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--open-ms") == 0 && hasValue) {
+            options.openMs = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--read-kbps") == 0 && hasValue) {
+            options.readKbps = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--spi-mhz") == 0 && hasValue) {
+            options.spiMhz = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--keep") == 0) {
+            keep = true;
+        } else {
+            printf("usage: %s [--tracks N] [--format mp3|wav] [--loop-ms M] [--open-ms O]\n"
+                   "          [--read-kbps R] [--spi-mhz S] [--keep]\n",
+                   argv[0]);
+            return 1;
+        }
+    }
+    if (options.tracks < 1) options.tracks = 1;
+    const bool wav = strcmp(options.format, "wav") == 0;
+
+    const std::string root = makeTempDir("boomerbox-sdi");
+    SD.setRoot(root.c_str());
+    Serial.enabled = false;
+    host_io_hook = chargeIo;
+    storage_bus.claim = claimBus;
+    storage_bus.release = releaseBus;
+
+    // About 3 seconds per track
+    std::vector<std::string> paths;
+    for (uint16_t i = 0; i < options.tracks; i++) {
+        SyntheticTags tags;
+        tags.title = "Track " + std::to_string(i + 1);
+        tags.track = i + 1;
+        std::string name = "/T" + std::to_string(i + 1);
+        std::string data;
+        if (wav) {
+            WavOptions wavOptions;
+            wavOptions.dataBytes = 44100 * 4 * 3;
+            data = makeWav(tags, wavOptions);
+            name += ".WAV";
+        } else {
+            Mp3Options mp3;
+            mp3.frames = 115;
+            data = makeMp3(tags, mp3);
+            name += ".MP3";
+        }
+        writeFile(root + name, data);
+        paths.push_back(name);
+    }
+
+    printf("%u %s tracks, loop %.1f ms, open %.1f ms, SD %.0f KB/s, SDI %.1f MHz\n\n",
+           options.tracks, wav ? "wav" : "mp3", options.loopMs, options.openMs,
+           options.readKbps, options.spiMhz);
+
+    const Result cpu = run(paths, false);
+    report("CPU writes the stream (Vs1053Output)", cpu);
+    const Result dma = run(paths, true);
+    report("DMA bursts through SdiScheduler (Vs1053DmaOutput)", dma);
+
+    printf("feeding CPU time: %.1f ms -> %.1f ms\n", cpu.cpuFeedUs / 1000.0, dma.cpuFeedUs / 1000.0);
+    printf("silence: %.2f ms -> %.2f ms\n", cpu.silenceUs / 1000.0, dma.silenceUs / 1000.0);
+    printf("violations: %u\n", violations);
+
+    if (!keep) removeTree(root);
+    return violations == 0 ? 0 : 2;
+}
@@ -0,0 +1,110 @@
+#include <Adafruit_LiquidCrystal.h>
+#include <Wire.h>
+
+namespace {
+constexpr uint8_t MCP23008_IODIR = 0x00;
+constexpr uint8_t MCP23008_GPIO = 0x09;
+
+constexpr uint8_t PIN_RS = 1;
+constexpr uint8_t PIN_EN = 2;
+constexpr uint8_t DATA_SHIFT = 3;
+constexpr uint8_t PIN_LITE = 7;
+}
+
+Adafruit_LiquidCrystal::Adafruit_LiquidCrystal(const uint8_t i2cAddr) : _address(0x20 | (i2cAddr & 0x07)) {
+}
+
+bool Adafruit_LiquidCrystal::begin(uint8_t /*cols*/, uint8_t /*rows*/) {
+    Wire.beginTransmission(_address);
+    Wire.write(MCP23008_IODIR);
+    Wire.write(0x00);
+    if (Wire.endTransmission() != 0) return false;
+
+    digitalWrite(PIN_RS, false);
+    digitalWrite(PIN_EN, false);
+    // Into 4-bit mode, from whatever mode it was in
+    write4bits(0x03);
+    write4bits(0x03);
+    write4bits(0x03);
+    write4bits(0x02);
+    command(0x28);  // 4-bit, 2 lines, 5x8
+    command(0x0C);  // display on, no cursor
+    clear();
+    command(0x06);  // left to right, no shift
+    return true;
+}
+
+void Adafruit_LiquidCrystal::clear() {
+    command(0x01);
+}
+
+void Adafruit_LiquidCrystal::home() {
+    command(0x02);
+}
+
+void Adafruit_LiquidCrystal::setCursor(const uint8_t col, const uint8_t row) {
+    static const uint8_t offsets[] = {0x00, 0x40, 0x14, 0x54};
+    command(0x80 | (col + offsets[row & 3]));
+}
+
+void Adafruit_LiquidCrystal::createChar(uint8_t location, uint8_t charmap[]) {
+    location &= 0x7;
+    command(0x40 | (location << 3));
+    for (uint8_t i = 0; i < 8; i++) {
+        write(charmap[i]);
+    }
+}
+
+void Adafruit_LiquidCrystal::setBacklight(const uint8_t value) {
+    digitalWrite(PIN_LITE, value != 0);
+}
+
+void Adafruit_LiquidCrystal::command(const uint8_t value) {
+    send(value, false);
+}
+
+size_t Adafruit_LiquidCrystal::write(const uint8_t value) {
+    send(value, true);
+    return 1;
+}
+
+void Adafruit_LiquidCrystal::send(const uint8_t value, const bool data) {
+    digitalWrite(PIN_RS, data);
+    write4bits(value >> 4);
+    write4bits(value);
+}
+
+void Adafruit_LiquidCrystal::write4bits(const uint8_t value) {
+    uint8_t out = readGPIO();
+    out &= ~(0x0F << DATA_SHIFT);
+    out |= (value & 0x0F) << DATA_SHIFT;
+    out &= ~(1 << PIN_EN);
+    writeGPIO(out);
+    writeGPIO(out | (1 << PIN_EN));
+    writeGPIO(out);
+}
+
+uint8_t Adafruit_LiquidCrystal::readGPIO() {
+    Wire.beginTransmission(_address);
+    Wire.write(MCP23008_GPIO);
+    Wire.endTransmission(false);
+    Wire.requestFrom(_address, 1);
+    return Wire.read();
+}
+
+void Adafruit_LiquidCrystal::writeGPIO(const uint8_t value) {
+    Wire.beginTransmission(_address);
+    Wire.write(MCP23008_GPIO);
+    Wire.write(value);
+    Wire.endTransmission();
+}
+
+void Adafruit_LiquidCrystal::digitalWrite(const uint8_t pin, const bool value) {
+    uint8_t out = readGPIO();
+    if (value) {
+        out |= 1 << pin;
+    } else {
+        out &= ~(1 << pin);
+    }
+    writeGPIO(out);
+}
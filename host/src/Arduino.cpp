@@ -0,0 +1,45 @@
+#include <Arduino.h>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+HostSerial Serial;
+
+static const auto host_epoch = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - host_epoch).count();
+}
+
+unsigned long micros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - host_epoch).count();
+}
+
+void delay(const unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(const unsigned int us) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+size_t Print::print(const char* s) {
+    size_t n = 0;
+    while (s && *s) {
+        n += write(static_cast<uint8_t>(*s++));
+    }
+    return n;
+}
+
+size_t Print::print(const double v) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.2f", v);
+    return print(buf);
+}
+
+size_t HostSerial::write(const uint8_t c) {
+    if (!enabled) return 1;
+    return fputc(c, stdout) == EOF ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+#include <SD.h>
+#include <cstdio>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SDClass SD;
+HostIoStats host_io_stats;
+void (*host_io_hook)(bool open, uint32_t bytes) = nullptr;
+
+struct HostFileHandle {
+    std::string hostPath;
+    char name[256] = {0};
+    FILE* fp = nullptr;
+    DIR* dir = nullptr;
+    uint32_t size = 0;
+    uint32_t modified = 0;
+
+    ~HostFileHandle() {
+        if (fp) fclose(fp);
+        if (dir) closedir(dir);
+    }
+};
+
+static std::shared_ptr<HostFileHandle> openHandle(const std::string& hostPath, const char* name, const uint8_t mode) {
+    struct stat st{};
+    const bool exists = stat(hostPath.c_str(), &st) == 0;
+    auto h = std::make_shared<HostFileHandle>();
+    h->hostPath = hostPath;
+    strncpy(h->name, name, sizeof(h->name) - 1);
+    if (exists) {
+        h->modified = static_cast<uint32_t>(st.st_mtim.tv_sec * 1000ull + st.st_mtim.tv_nsec / 1000000);
+    }
+
+    if (exists && S_ISDIR(st.st_mode)) {
+        h->dir = opendir(hostPath.c_str());
+        if (!h->dir) return nullptr;
+        host_io_stats.dirOpens++;
+        return h;
+    }
+
+    if (mode == FILE_READ) {
+        if (!exists) return nullptr;
+        h->fp = fopen(hostPath.c_str(), "rb");
+    } else {
+        h->fp = fopen(hostPath.c_str(), exists ? "r+b" : "w+b");
+        if (h->fp) fseek(h->fp, 0, SEEK_END);
+    }
+    if (!h->fp) return nullptr;
+    host_io_stats.fileOpens++;
+    h->size = exists ? static_cast<uint32_t>(st.st_size) : 0;
+    if (host_io_hook) host_io_hook(true, 0);
+    return h;
+}
+
+size_t File::write(const uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t File::write(const uint8_t* buf, const size_t size) {
+    if (!_h || !_h->fp) return 0;
+    const size_t n = fwrite(buf, 1, size, _h->fp);
+    host_io_stats.writeCalls++;
+    host_io_stats.bytesWritten += n;
+    const long pos = ftell(_h->fp);
+    if (pos > static_cast<long>(_h->size)) _h->size = static_cast<uint32_t>(pos);
+    return n;
+}
+
+int File::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::read(void* buf, const uint16_t nbyte) {
+    if (!_h || !_h->fp) return -1;
+    const size_t n = fread(buf, 1, nbyte, _h->fp);
+    host_io_stats.readCalls++;
+    host_io_stats.bytesRead += n;
+    if (host_io_hook) host_io_hook(false, static_cast<uint32_t>(n));
+    return static_cast<int>(n);
+}
+
+int File::peek() {
+    if (!_h || !_h->fp) return -1;
+    const int c = fgetc(_h->fp);
+    if (c != EOF) ungetc(c, _h->fp);
+    return c == EOF ? -1 : c;
+}
+
+int File::available() {
+    if (!_h || !_h->fp) return 0;
+    const uint32_t pos = position();
+    return pos < _h->size ? static_cast<int>(_h->size - pos) : 0;
+}
+
+void File::flush() {
+    if (_h && _h->fp) fflush(_h->fp);
+}
+
+bool File::seek(const uint32_t pos) {
+    if (!_h || !_h->fp || pos > _h->size) return false;
+    host_io_stats.seekCalls++;
+    return fseek(_h->fp, pos, SEEK_SET) == 0;
+}
+
+uint32_t File::position() {
+    if (!_h || !_h->fp) return 0;
+    return static_cast<uint32_t>(ftell(_h->fp));
+}
+
+uint32_t File::size() {
+    return _h ? _h->size : 0;
+}
+
+void File::close() {
+    _h.reset();
+}
+
+File::operator bool() const {
+    return _h != nullptr;
+}
+
+char* File::name() {
+    static char empty[1] = {0};
+    return _h ? _h->name : empty;
+}
+
+bool File::isDirectory() {
+    return _h && _h->dir;
+}
+
+uint32_t File::modified() {
+    return _h ? _h->modified : 0;
+}
+
+File File::openNextFile(const uint8_t mode) {
+    File next;
+    if (!_h || !_h->dir) return next;
+    host_io_stats.dirReads++;
+    while (const dirent* ent = readdir(_h->dir)) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) continue;
+        next._h = openHandle(_h->hostPath + "/" + ent->d_name, ent->d_name, mode);
+        if (next) break;
+    }
+    return next;
+}
+
+void File::rewindDirectory() {
+    if (_h && _h->dir) rewinddir(_h->dir);
+}
+
+bool SDClass::begin(uint8_t) {
+    if (_root.empty()) {
+        const char* env = getenv("BOOMERBOX_SD_ROOT");
+        _root = env ? env : ".";
+    }
+    struct stat st{};
+    return stat(_root.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+void SDClass::setRoot(const char* hostPath) {
+    _root = hostPath;
+}
+
+std::string SDClass::hostPath(const char* path) const {
+    std::string p = _root;
+    if (path && *path && *path != '/') p += '/';
+    if (path) p += path;
+    while (p.size() > 1 && p.back() == '/') p.pop_back();
+    return p;
+}
+
+File SDClass::open(const char* path, const uint8_t mode) {
+    File f;
+    const char* slash = path ? strrchr(path, '/') : nullptr;
+    const char* name = slash ? slash + 1 : (path ? path : "");
+    f._h = openHandle(hostPath(path), *name ? name : "/", mode);
+    return f;
+}
+
+bool SDClass::exists(const char* path) {
+    struct stat st{};
+    return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool SDClass::mkdir(const char* path) {
+    return ::mkdir(hostPath(path).c_str(), 0755) == 0;
+}
+
+bool SDClass::remove(const char* path) {
+    return unlink(hostPath(path).c_str()) == 0;
+}
+
+bool SDClass::rmdir(const char* path) {
+    return ::rmdir(hostPath(path).c_str()) == 0;
+}
@@ -0,0 +1,161 @@
+#include <Wire.h>
+#include <cstring>
+
+HostI2cStats host_i2c_stats;
+TwoWire Wire;
+
+namespace {
+
+constexpr uint8_t BACKPACK_ADDRESS = 0x20;
+
+// HD44780 fed one port value at a time; latches on E falling
+struct Hd44780 {
+    bool fourBit = false;
+    bool haveHigh = false;
+    uint8_t high = 0;
+    bool enable = false;
+    bool cgram = false;
+    uint8_t counter = 0;
+    char ddram[128];
+    uint8_t glyphs[64] = {};
+
+    Hd44780() { memset(ddram, ' ', sizeof(ddram)); }
+
+    void pins(const uint8_t port) {
+        const bool e = port & 0x04;
+        if (enable && !e) latch(port & 0x02, (port >> 3) & 0x0F);
+        enable = e;
+    }
+
+    void latch(const bool rs, const uint8_t nibble) {
+        // Until switched to 4-bit mode, each strobe is a whole (8-bit) write
+        // with the low data lines unconnected
+        if (!fourBit) {
+            execute(rs, nibble << 4);
+        } else if (!haveHigh) {
+            high = nibble;
+            haveHigh = true;
+        } else {
+            haveHigh = false;
+            execute(rs, (high << 4) | nibble);
+        }
+    }
+
+    void execute(const bool rs, const uint8_t value) {
+        if (rs) {
+            if (cgram) {
+                glyphs[counter & 0x3F] = value;
+            } else {
+                ddram[counter & 0x7F] = static_cast<char>(value);
+            }
+            counter++;
+        } else if (value & 0x80) {
+            counter = value & 0x7F;
+            cgram = false;
+        } else if (value & 0x40) {
+            counter = value & 0x3F;
+            cgram = true;
+        } else if (value & 0x20) {
+            fourBit = !(value & 0x10);
+            haveHigh = false;
+        } else if (value == 0x01) {
+            memset(ddram, ' ', sizeof(ddram));
+            counter = 0;
+            cgram = false;
+        } else if (value & 0x02 && value < 0x04) {
+            counter = 0;
+            cgram = false;
+        }
+    }
+};
+
+// MCP23008 registers; the pointer advances after each byte unless
+// IOCON.SEQOP is set
+struct Mcp23008 {
+    static constexpr uint8_t IOCON = 0x05;
+    static constexpr uint8_t GPIO = 0x09;
+    static constexpr uint8_t OLAT = 0x0A;
+
+    uint8_t registers[11] = {0xFF};
+    uint8_t pointer = 0;
+    Hd44780 lcd;
+
+    void write(const std::vector<uint8_t>& bytes) {
+        if (bytes.empty()) return;
+        pointer = bytes[0];
+        for (size_t i = 1; i < bytes.size(); i++) {
+            if (pointer < sizeof(registers)) {
+                registers[pointer] = bytes[i];
+                if (pointer == GPIO || pointer == OLAT) {
+                    registers[GPIO] = registers[OLAT] = bytes[i];
+                    lcd.pins(bytes[i]);
+                }
+            }
+            advance();
+        }
+    }
+
+    uint8_t read() {
+        const uint8_t value = pointer < sizeof(registers) ? registers[pointer] : 0;
+        advance();
+        return value;
+    }
+
+    void advance() {
+        if (registers[IOCON] & 0x20) return;
+        pointer = pointer + 1u < sizeof(registers) ? pointer + 1 : 0;
+    }
+};
+
+Mcp23008 backpack;
+
+}
+
+void TwoWire::beginTransmission(const uint8_t address) {
+    _address = address;
+    _tx.clear();
+}
+
+size_t TwoWire::write(const uint8_t value) {
+    _tx.push_back(value);
+    return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool /*stop*/) {
+    host_i2c_stats.transactions++;
+    host_i2c_stats.bytes += _tx.size();
+    if (_address != BACKPACK_ADDRESS) return 2;
+    backpack.write(_tx);
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(const uint8_t address, const uint8_t count) {
+    host_i2c_stats.transactions++;
+    _rx.clear();
+    if (address != BACKPACK_ADDRESS) return 0;
+    for (uint8_t i = 0; i < count; i++) {
+        _rx.push_back(backpack.read());
+    }
+    host_i2c_stats.bytes += count;
+    return count;
+}
+
+int TwoWire::available() {
+    return static_cast<int>(_rx.size());
+}
+
+int TwoWire::read() {
+    if (_rx.empty()) return -1;
+    const uint8_t value = _rx.front();
+    _rx.erase(_rx.begin());
+    return value;
+}
+
+char host_lcd_at(const uint8_t row, const uint8_t col) {
+    static const uint8_t offsets[] = {0x00, 0x40, 0x14, 0x54};
+    return backpack.lcd.ddram[(offsets[row & 3] + col) & 0x7F];
+}
+
+const uint8_t* host_lcd_glyph(const uint8_t slot) {
+    return backpack.lcd.glyphs + (slot & 7) * 8;
+}
@@ -0,0 +1,225 @@
+// Stress test of the core0 -> core1 command path on real threads: first the
+// bare SpscQueue, with a producer and a consumer thread checking that every
+// item arrives once, in order and whole; then AudioCore, with an audio thread
+// servicing an AudioFeeder (over a decoder paced in real time) while the
+// main thread posts playback commands and checks the feeder's state once
+// each batch has settled. Waiting threads yield, so it also runs on a
+// single core.
+//
+//   pio run -e stress_spsc
+//   .pio/build/stress_spsc/program [--items N] [--rounds R] [--keep]
+
+#include <Arduino.h>
+#include <SD.h>
+#include <audio_core.h>
+#include <spsc_queue.h>
+#include "../bench/synthetic_media.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <thread>
+
+static uint32_t errors = 0;
+
+static void fail(const char* what, const uint32_t value) {
+    if (errors++ < 10) printf("  FAIL: %s (%u)\n", what, value);
+}
+
+// ============================================================================
+// SpscQueue
+// ============================================================================
+
+struct Item {
+    uint32_t sequence;
+    uint8_t payload[60];  // filled from sequence, to catch torn copies
+};
+
+static void fillItem(Item& item, const uint32_t sequence) {
+    item.sequence = sequence;
+    for (uint8_t i = 0; i < sizeof(item.payload); i++) {
+        item.payload[i] = static_cast<uint8_t>(sequence * 31 + i);
+    }
+}
+
+static void stressQueue(const uint32_t items) {
+    SpscQueue<Item, 8> queue;
+    uint32_t fullPushes = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    std::thread consumer([&] {
+        Item item;
+        uint32_t expected = 0;
+        while (expected < items) {
+            if (!queue.pop(item)) {
+                std::this_thread::yield();
+                continue;
+            }
+            if (item.sequence != expected) fail("out of order", item.sequence);
+            for (uint8_t i = 0; i < sizeof(item.payload); i++) {
+                if (item.payload[i] != static_cast<uint8_t>(item.sequence * 31 + i)) {
+                    fail("torn item", item.sequence);
+                    break;
+                }
+            }
+            expected++;
+        }
+    });
+
+    Item item;
+    for (uint32_t sequence = 0; sequence < items; sequence++) {
+        fillItem(item, sequence);
+        while (!queue.push(item)) {
+            fullPushes++;
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+    if (!queue.empty()) fail("not empty at the end", 0);
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("SpscQueue: %u items in %.2f s (%.1f M/s), producer found it full %u times\n",
+           items, seconds, items / seconds / 1e6, fullPushes);
+}
+
+// ============================================================================
+// AudioCore
+// ============================================================================
+
+// Takes data as a 2 KB decoder buffer playing 128 kbps would, in real time
+class PacedOutput : public AudioOutput {
+public:
+    std::atomic<uint64_t> bytes{0};
+
+    bool readyForData() override {
+        const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - _start).count();
+        return bytes + 32 <= us * (128000.0 / 8 / 1e6) + 2048;
+    }
+    void playData(uint8_t* /*data*/, const uint8_t length) override { bytes += length; }
+    void beginStream() override {}
+    uint8_t endFillByte() override { return 0; }
+    void requestCancel() override {}
+    bool cancelPending() override { return false; }
+
+private:
+    const std::chrono::steady_clock::time_point _start = std::chrono::steady_clock::now();
+};
+
+static uint8_t last_volume = 0;
+
+static void setVolume(const uint8_t volume) {
+    last_volume = volume;
+}
+
+static void waitSettled(const AudioCore& core) {
+    while (!core.settled()) std::this_thread::yield();
+}
+
+static void stressAudioCore(const uint16_t rounds) {
+    PacedOutput output;
+    AudioFeeder feeder(output);
+    AudioCore core(feeder, output, setVolume);
+
+    std::atomic<bool> running{true};
+    uint32_t services = 0;
+    std::thread audio([&] {
+        while (running.load(std::memory_order_acquire)) {
+            if (core.hasWork()) {
+                core.service();
+                services++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t posted = 0;
+    uint32_t fullPosts = 0;
+    const auto postOrRetry = [&](const std::function<bool()>& post) {
+        while (!post()) {
+            fullPosts++;
+            std::this_thread::yield();
+        }
+        posted++;
+    };
+
+    for (uint16_t round = 0; round < rounds; round++) {
+        const std::string first = "/T" + std::to_string(round % 3 + 1) + ".MP3";
+        const std::string second = "/T" + std::to_string((round + 1) % 3 + 1) + ".MP3";
+        const uint8_t volume = static_cast<uint8_t>(round);
+
+        // A burst of commands, more than the queue holds
+        postOrRetry([&] { return core.play(first.c_str()); });
+        postOrRetry([&] { return core.queue(second.c_str()); });
+        postOrRetry([&] { return core.pause(true); });
+        postOrRetry([&] { return core.setVolume(volume); });
+        for (uint8_t i = 0; i < 6; i++) {
+            postOrRetry([&] { return core.queue(second.c_str()); });
+        }
+        waitSettled(core);
+        if (!feeder.playing()) fail("not playing after play", round);
+        if (!feeder.paused()) fail("not paused after pause", round);
+        if (!feeder.hasQueued()) fail("nothing queued after queue", round);
+        if (last_volume != volume) fail("volume not applied", round);
+
+        postOrRetry([&] { return core.pause(false); });
+        postOrRetry([&] { return core.clearQueue(); });
+        waitSettled(core);
+        if (feeder.paused()) fail("paused after resume", round);
+        if (feeder.hasQueued()) fail("queued after clearQueue", round);
+
+        postOrRetry([&] { return core.stop(); });
+        waitSettled(core);
+        if (feeder.playing()) fail("playing after stop", round);
+    }
+
+    // A file that is not there is counted, not fatal
+    const uint16_t failures = core.failures();
+    postOrRetry([&] { return core.play("/MISSING.MP3"); });
+    waitSettled(core);
+    if (core.failures() != failures + 1) fail("missing file not counted", core.failures());
+    if (feeder.playing()) fail("playing a missing file", 0);
+
+    running.store(false, std::memory_order_release);
+    audio.join();
+    printf("AudioCore: %u rounds, %u commands (queue full %u times), %u services, %llu bytes fed\n",
+           rounds, posted, fullPosts, services, static_cast<unsigned long long>(output.bytes.load()));
+}
+
+int main(int argc, char** argv) {
+    uint32_t items = 5000000;
+    uint16_t rounds = 500;
+    bool keep = false;
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--items") == 0 && hasValue) {
+            items = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--rounds") == 0 && hasValue) {
+            rounds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--keep") == 0) {
+            keep = true;
+        } else {
+            printf("usage: %s [--items N] [--rounds R] [--keep]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    const std::string root = makeTempDir("boomerbox-spsc");
+    SD.setRoot(root.c_str());
+    Serial.enabled = false;
+    for (uint8_t i = 1; i <= 3; i++) {
+        SyntheticTags tags;
+        tags.title = "Track " + std::to_string(i);
+        Mp3Options mp3;
+        mp3.frames = 200;
+        writeFile(root + "/T" + std::to_string(i) + ".MP3", makeMp3(tags, mp3));
+    }
+
+    stressQueue(items);
+    stressAudioCore(rounds);
+    printf("errors: %u\n", errors);
+
+    if (!keep) removeTree(root);
+    return errors == 0 ? 0 : 2;
+}
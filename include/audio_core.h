@@ -0,0 +1,89 @@
+//
+// Playback control, run either inline from loop() or on a core of its own.
+//
+// On the RP2040 (unless built with -D AUDIO_SINGLE_CORE) the feeder runs on
+// core1: loop() posts commands to it through a lock-free queue, and core1
+// carries them out, reads ahead and feeds the decoder, so nothing core0 does
+// (album loading, LCD redraws) can hold up the audio. Elsewhere the same
+// commands are carried out as they are posted.
+//
+
+#ifndef BOOMERBOX_AUDIO_CORE_H
+#define BOOMERBOX_AUDIO_CORE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <audio_feeder.h>
+#include <media.h>
+#include <spsc_queue.h>
+
+#if defined(ARDUINO_ARCH_RP2040) && !defined(AUDIO_SINGLE_CORE)
+#define AUDIO_CORE1
+#endif
+
+struct AudioCommand {
+    enum class Type : uint8_t {
+        PLAY,        // path
+        QUEUE,       // path
+        CLEAR_QUEUE,
+        PAUSE,
+        RESUME,
+        STOP,
+        VOLUME,      // volume
+    };
+
+    Type type = Type::STOP;
+    uint8_t volume = 0;
+    char path[SONG_PATH_LEN] = {};
+};
+
+class AudioCore {
+public:
+    static constexpr uint8_t QUEUE_SIZE = 8;
+
+    // setVolume writes the decoder's attenuation (0 loudest), on the audio side
+    AudioCore(AudioFeeder& feeder, AudioOutput& output, void (*setVolume)(uint8_t));
+
+    // Commands are carried out in order. Posting returns false if the queue
+    // is full, or when run inline, if the command failed (a file that could
+    // not be opened).
+    bool play(const char* path);
+    bool queue(const char* path);
+    bool clearQueue();
+    bool pause(bool paused);
+    bool stop();
+    bool setVolume(uint8_t volume);
+
+    // Everything posted has been carried out, so the feeder's state (playing(),
+    // advances()) reflects it
+    bool settled() const { return _done.load(std::memory_order_acquire) == _posted; }
+
+    // Opens that failed, on either side
+    uint16_t failures() const { return _failures.load(std::memory_order_relaxed); }
+
+    // Audio side: there are commands to carry out, data to read ahead or a
+    // decoder asking for data
+    bool hasWork();
+
+    // Audio side: carry out posted commands, read ahead and feed the decoder
+    void service();
+
+    // Carry out commands as they are posted rather than waiting for service()
+    void runInline(const bool enabled) { _inline = enabled; }
+
+private:
+    bool post(AudioCommand::Type type, const char* path = nullptr, uint8_t volume = 0);
+    bool run(const AudioCommand& command);
+
+    AudioFeeder& _feeder;
+    AudioOutput& _output;
+    void (*_setVolume)(uint8_t);
+    bool _inline = false;
+    SpscQueue<AudioCommand, QUEUE_SIZE> _commands;
+    AudioCommand _next;             // producer's scratch, kept off the stack
+    uint32_t _posted = 0;           // producer only
+    std::atomic<uint32_t> _done{0}; // consumer only
+    std::atomic<uint16_t> _failures{0};
+};
+
+#endif //BOOMERBOX_AUDIO_CORE_H
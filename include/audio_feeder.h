@@ -0,0 +1,161 @@
+//
+// Streams tracks from the SD card to the audio decoder, with the next track
+// opened ahead of time so album playback is gapless.
+//
+
+#ifndef BOOMERBOX_AUDIO_FEEDER_H
+#define BOOMERBOX_AUDIO_FEEDER_H
+
+#include <Arduino.h>
+#include <storage.h>
+
+// The decoder end of the feeder: the VS1053 on the device (vs1053_output.h),
+// a simulated decoder on the host.
+class AudioOutput {
+public:
+    // DREQ: the decoder can take at least 32 more bytes
+    virtual bool readyForData() = 0;
+    virtual void playData(uint8_t* data, uint8_t length) = 0;
+
+    // Prepare the decoder for the start of a new stream
+    virtual void beginStream() = 0;
+
+    // Byte to pad the end of a stream with, so the decoder flushes its last samples
+    virtual uint8_t endFillByte() = 0;
+
+    // Ask the decoder to drop the current stream, and check whether it has
+    virtual void requestCancel() = 0;
+    virtual bool cancelPending() = 0;
+
+protected:
+    ~AudioOutput() = default;
+};
+
+enum class StreamFormat : uint8_t {
+    MP3,
+    OGG,
+    WAV,
+    OTHER
+};
+
+// Smallest power of two that holds bytes, for the feeder's ring
+constexpr uint16_t ringSize(const uint32_t bytes, const uint16_t size = 1) {
+    return size >= bytes ? size : ringSize(bytes, static_cast<uint16_t>(size * 2));
+}
+
+// Feeds one track at a time and switches to the queued track as soon as the
+// current file runs out:
+//  - MP3 to MP3, the next file is appended to the same stream; the decoder
+//    resynchronises on the next frame header, so there is no gap at all.
+//  - Otherwise the stream is ended as the VS1053 datasheet describes (end
+//    fill bytes, then SM_CANCEL) and the already open next file starts
+//    straight away, a few milliseconds instead of a directory search.
+//
+// Card reads and decoder writes are decoupled by a read-ahead ring. fill()
+// tops the ring up from loop() in READ_SIZE reads (several card sectors at
+// once), reading into the queued track once the current file is exhausted.
+// feed() drains it to the decoder 32 bytes per DREQ and never touches the
+// card, so it is safe to call from the DREQ or DMA interrupt, and a slow card
+// read or a busy loop() only costs playback once the ring runs dry.
+//
+// Everything except feed() is only called from loop().
+class AudioFeeder {
+public:
+    static constexpr uint8_t CHUNK_SIZE = 32;
+    static constexpr uint16_t READ_SIZE = 2048;
+    // The ring has to outlast the longest wait for fill(): a card stall
+    // (wear levelling, a slow sector) plus a loop() pass, at the highest
+    // bitrate played, 1411 kbps WAV. Rounded up to a power of two, which
+    // comes to 186 ms of WAV, on top of the decoder's own 2 KB.
+    static constexpr uint32_t MAX_BYTES_PER_SECOND = 176400;
+    static constexpr uint16_t MAX_STALL_MS = 150;
+    static constexpr uint16_t RING_SIZE =
+        ringSize(MAX_BYTES_PER_SECOND * MAX_STALL_MS / 1000 + READ_SIZE);
+    static constexpr uint16_t END_FILL_BYTES = 2052;
+    // Give up waiting for SM_CANCEL to clear after this many fill bytes
+    static constexpr uint16_t CANCEL_FILL_BYTES = 2048;
+
+    explicit AudioFeeder(AudioOutput& output);
+
+    // Stop whatever is playing and start a track. Returns false if it cannot be opened.
+    bool play(const char* path);
+
+    // Open the track to play when the current one ends, replacing any queued track
+    bool queue(const char* path);
+    void clearQueue();
+    bool hasQueued() const { return _tracks[_playing ^ 1].ready; }
+
+    void stop();
+    void pause(bool paused);
+    bool paused() const { return _paused; }
+
+    // Read ahead from the card while the ring has room
+    void fill();
+    // fill() has something to do
+    bool needsFill() const {
+        return _state != State::IDLE && _tracks[_reading].file.id() != 0 &&
+               RING_SIZE - (_head - _tail) >= READ_SIZE;
+    }
+
+    // Send buffered data while the decoder wants it
+    void feed();
+
+    // True until the last track has been sent and the decoder flushed
+    bool playing() const { return _state != State::IDLE; }
+
+    // Number of times playback moved on to a queued track by itself.
+    // Compare against the last value seen to notice a track change.
+    uint16_t advances() const { return _advances; }
+
+    // Times the decoder asked for data mid-track and the ring was empty
+    uint16_t underruns() const { return _underruns; }
+
+    // Bytes read ahead and not yet sent
+    uint16_t buffered() const { return _head - _tail; }
+
+private:
+    enum class State : uint8_t {
+        IDLE,
+        STREAMING,  // sending the current track
+        END_FILL,   // padding the end of the stream
+        CANCELLING  // waiting for the decoder to drop the stream
+    };
+
+    // A playing or queued track. Its data follows the previous track's in
+    // the ring; end is where it stops, known once the file has been read.
+    struct Track {
+        StorageFile file;   // open until read to the end
+        StreamFormat format = StreamFormat::OTHER;
+        volatile uint32_t end = 0;
+        volatile bool ended = false;
+        volatile bool ready = false;
+    };
+
+    bool open(const char* path, StorageFile& file, StreamFormat& format);
+    void install(Track& track, StorageFile& file, StreamFormat format);
+    void close(Track& track);
+    // Let feed() run again after loop() held it off
+    void release();
+    void startNext();
+    bool feedChunk();
+
+    AudioOutput& _output;
+    Track _tracks[2];
+    volatile uint8_t _playing = 0;  // index of the track being sent
+    uint8_t _reading = 0;           // index of the track fill() reads from
+    uint8_t _ring[RING_SIZE] = {};
+    // Totals written and sent; their difference is what is buffered
+    volatile uint32_t _head = 0;
+    volatile uint32_t _tail = 0;
+    volatile State _state = State::IDLE;
+    volatile bool _busy = false;
+    volatile bool _pending = false;
+    volatile bool _paused = false;
+    volatile bool _starved = false;
+    volatile uint16_t _advances = 0;
+    volatile uint16_t _underruns = 0;
+    uint16_t _fillSent = 0;
+    uint8_t _fillByte = 0;
+};
+
+#endif //BOOMERBOX_AUDIO_FEEDER_H
@@ -0,0 +1,67 @@
+//
+// Buffered, block-aligned reader over a StorageFile for the metadata parsers.
+//
+
+#ifndef BOOMERBOX_BLOCK_READER_H
+#define BOOMERBOX_BLOCK_READER_H
+
+#include <Arduino.h>
+#include <storage.h>
+#include <sector_cache.h>
+
+// Reads a file in whole card blocks so that small reads (single bytes,
+// header fields) are served from RAM instead of going through the SD
+// library one call at a time. Blocks come from the shared SectorCache, so
+// seeking back to a block read recently is free too.
+class BlockReader {
+public:
+    static constexpr uint16_t BLOCK_SIZE = SectorCache::SECTOR_SIZE;
+
+    explicit BlockReader(StorageFile &file);
+
+    StorageFile& file() { return _file; }
+    uint32_t size() const { return _size; }
+    uint32_t position() const { return _pos; }
+    uint32_t remaining() const { return _pos < _size ? _size - _pos : 0; }
+
+    // Move the read position. Returns false if pos is past the end of the file.
+    bool seek(uint32_t pos);
+    bool skip(uint32_t count) { return seek(_pos + count); }
+
+    // Single bytes, -1 at end of file
+    int peek();
+    int read();
+
+    // Read up to count bytes, returns the number of bytes read
+    uint16_t read(void* dest, uint16_t count);
+
+    // Fixed-width integers. Missing bytes (end of file) read as zero.
+    uint16_t read_u16le();
+    uint32_t read_u24be();
+    uint32_t read_u32be();
+    uint32_t read_u32le();
+    uint64_t read_u64le();
+    uint32_t read_syncsafe();
+
+    // Search forward from the current position for pattern, looking at no
+    // more than limit bytes. On success the position is left at the start
+    // of the match; otherwise it is left after the searched range.
+    bool find(const void* pattern, uint8_t length, uint32_t limit);
+
+    // Search backwards for a match starting before the current position,
+    // looking no further back than limit bytes. On success the position is
+    // left at the start of the match; otherwise it is unchanged.
+    bool rfind(const void* pattern, uint8_t length, uint32_t limit);
+
+private:
+    bool fill(uint32_t pos);
+
+    StorageFile &_file;
+    uint32_t _size;
+    uint32_t _pos = 0;
+    uint32_t _bufStart = 0;
+    uint16_t _bufLen = 0;
+    const uint8_t* _buf = nullptr; // in the sector cache
+};
+
+#endif //BOOMERBOX_BLOCK_READER_H
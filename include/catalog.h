@@ -0,0 +1,120 @@
+//
+// Persistent album catalog stored on the SD card.
+//
+// The catalog is the album list itself: fixed-size records in the order the
+// directories were scanned, followed by a table giving the sorted order, so
+// albums can be paged in by position without holding the library in RAM.
+//
+
+#ifndef BOOMERBOX_CATALOG_H
+#define BOOMERBOX_CATALOG_H
+
+#include <Arduino.h>
+#include <storage.h>
+#include <media.h>
+
+// 8.3 names, which every storage backend supports.
+// The SD library cannot rename files, so a rescan writes the new
+// catalog to whichever of the two is not current and then removes the old one.
+#define CATALOG_PATH "/LIBRARY.IDX"
+#define CATALOG_ALT_PATH "/LIBRARY.ID2"
+
+constexpr uint32_t CATALOG_MAGIC = 0x42424F58; // "BBOX"
+constexpr uint32_t CATALOG_END_MAGIC = 0x58424242;
+constexpr uint16_t CATALOG_VERSION = 4;
+
+// Footer flags
+constexpr uint16_t CATALOG_FLAG_SORTED = 0x0001;
+
+// Fixed-size album record, two per 512-byte card sector
+struct CatalogRecord {
+    char path[ALBUM_PATH_LEN];
+    char title[ALBUM_TEXT_LEN];
+    char artist[ALBUM_TEXT_LEN];
+    uint32_t dir_signature;
+    uint32_t dir_modified;   // directory timestamp when validated, 0 if unknown
+    uint16_t dir_entries;
+    uint8_t expected_song_count;
+    uint8_t reserved[5];
+};
+static_assert(sizeof(CatalogRecord) == 256, "catalog records must stay sector aligned");
+
+// Layout: CatalogRecord[album_count], uint16_t order[album_count], CatalogFooter.
+// The footer is written last, so a catalog cut short by power loss is rejected.
+struct CatalogFooter {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint16_t album_count;
+    uint16_t flags;
+    uint32_t generation;
+    uint32_t checksum;   // of the records, the order table and the fields above
+    uint32_t end_magic;
+};
+
+// Cheap fingerprint of a directory's contents (entry names, sizes and types).
+// If it still matches the catalog, the album does not need to be re-parsed.
+struct DirFingerprint {
+    uint16_t entries = 0;
+    uint32_t signature = 2166136261u; // FNV-1a offset basis
+
+    void add(const char* name, uint32_t size, bool isDirectory);
+};
+
+// Copy the displayable fields of a record into an album
+void albumFromRecord(const CatalogRecord& record, Album& album);
+
+// Read access to the current catalog
+class Catalog {
+public:
+    // Open the newest valid catalog on the card. Returns false if there is none.
+    bool open();
+    void close();
+
+    bool isOpen() const { return _open; }
+    uint16_t count() const { return _open ? _count : 0; }
+    uint32_t generation() const { return _generation; }
+    bool sorted() const { return _flags & CATALOG_FLAG_SORTED; }
+    const char* path() const { return _path; }
+
+    // Record by scan order
+    bool readRecord(uint16_t index, CatalogRecord& record);
+
+    // Record indices for count sorted positions starting at position
+    bool readOrder(uint16_t position, uint16_t* indices, uint16_t count);
+
+private:
+    bool openFile(const char* path, CatalogFooter& footer);
+
+    StorageFile _file;
+    const char* _path = CATALOG_PATH;
+    bool _open = false;
+    uint16_t _count = 0;
+    uint16_t _flags = 0;
+    uint32_t _generation = 0;
+};
+
+// Writes a new catalog. Records are appended in scan order; finish() adds
+// the sorted order table and the footer.
+class CatalogWriter {
+public:
+    bool begin(const char* path, uint32_t generation);
+    bool append(const CatalogRecord& record);
+    // Make the records written so far readable through another handle
+    void flush();
+    bool finish(const uint16_t* order, bool sorted);
+    void abort();
+
+    uint16_t count() const { return _count; }
+    const char* path() const { return _path; }
+
+private:
+    StorageFile _file;
+    const char* _path = nullptr;
+    uint32_t _generation = 0;
+    uint16_t _count = 0;
+    uint32_t _checksum = 0; // of everything written so far
+    bool _ok = false;
+};
+
+#endif //BOOMERBOX_CATALOG_H
@@ -0,0 +1,39 @@
+//
+// Sort order for album and song names.
+//
+
+#ifndef BOOMERBOX_COLLATION_H
+#define BOOMERBOX_COLLATION_H
+
+#include <Arduino.h>
+
+// Produces the collation key of a string one byte at a time: letters lose
+// their accents and are case-folded, a leading "The " is ignored, and each
+// run of digits becomes a length byte followed by the digits without leading
+// zeros, so "Track 2" sorts before "Track 10". Keys compare bytewise (memcmp)
+// and never contain 0.
+class CollationCursor {
+public:
+    explicit CollationCursor(const char* text);
+
+    // Next key byte, or -1 at the end of the string
+    int next();
+
+private:
+    const char* _text;
+    uint8_t _pendingDigits = 0;
+};
+
+// Compare the collation keys of two strings. Strings with the same key
+// ("Abc" and "abc", "07" and "7") compare equal.
+int compareKeys(const char* a, const char* b);
+
+// Compare two strings in collation order, falling back to the raw strings
+// for equal keys so the order is always deterministic
+int collate(const char* a, const char* b);
+
+// Write up to size bytes of a string's key, zero-filling the rest.
+// Returns the number of key bytes written.
+uint8_t collationKey(const char* text, uint8_t* key, uint8_t size);
+
+#endif //BOOMERBOX_COLLATION_H
@@ -0,0 +1,79 @@
+//
+// Single-pass directory listing for the library scan and album loading.
+//
+
+#ifndef BOOMERBOX_DIR_LISTING_H
+#define BOOMERBOX_DIR_LISTING_H
+
+#include <Arduino.h>
+#include <storage.h>
+#include <string_arena.h>
+
+// Directory I/O totals, for profiling. Every entry read is a trip through
+// the storage backend, so entries read is the number that matters.
+struct DirStats {
+    uint32_t opens = 0;     // directories opened by path
+    uint32_t passes = 0;    // passes over a directory's entries
+    uint32_t entries = 0;   // openNextEntry() calls
+
+    void reset() { *this = DirStats(); }
+};
+
+extern DirStats dir_stats;
+
+// Counted stand-ins for opening a directory, rewinding it and reading its
+// next entry. openNextEntry() opens the entry into entry, closing whatever
+// entry held; returns false at the end of the directory.
+StorageFile openDirectory(const char* path);
+void rewindEntries(StorageFile& dir);
+bool openNextEntry(StorageFile& dir, StorageFile& entry);
+
+struct DirEntry {
+    TextRef name;
+    bool isDirectory;
+    bool isAudio;
+    uint32_t size;
+    uint32_t modified;  // directories only; 0 if unknown
+};
+
+// The entries of one directory, read in a single pass and classified once.
+// Entries go in a buffer grown in steps of GROW_STEP, names in a StringArena.
+class DirListing {
+public:
+    static constexpr uint8_t GROW_STEP = 16;
+
+    DirListing() = default;
+    ~DirListing();
+    DirListing(const DirListing&) = delete;
+    DirListing& operator=(const DirListing&) = delete;
+
+    // List dir from the start. With keepFirstAudio, the first audio file is
+    // left open (see firstAudio()) rather than opened again later.
+    // Returns false if memory ran out; the entries read so far are kept.
+    bool read(StorageFile& dir, bool keepFirstAudio = false);
+
+    uint16_t count() const { return _count; }
+    const DirEntry& operator[](const uint16_t index) const { return _entries[index]; }
+    const char* name(const DirEntry& entry) const { return _names.at(entry.name); }
+
+    uint16_t audioCount() const { return _audioCount; }
+    bool hasSubdirs() const { return _hasSubdirs; }
+
+    // First audio file, if read() kept it open. Closed by clear().
+    StorageFile& firstAudio() { return _firstAudio; }
+
+    void clear();
+
+private:
+    bool append(StorageFile& entry);
+
+    DirEntry* _entries = nullptr;
+    uint16_t _count = 0;
+    uint16_t _capacity = 0;
+    uint16_t _audioCount = 0;
+    bool _hasSubdirs = false;
+    StringArena _names;
+    StorageFile _firstAudio;
+};
+
+#endif //BOOMERBOX_DIR_LISTING_H
@@ -12,10 +12,29 @@
 extern uint8_t up_arrow[];
 extern uint8_t down_arrow[];
 
+// I2C traffic of the batched driver
+struct LcdStats {
+    uint32_t transactions = 0;
+    uint32_t bytes = 0;   // GPIO writes, each a nibble edge
+    uint32_t cells = 0;   // characters written
+    uint32_t errors = 0;  // transactions the backpack did not acknowledge
+    uint32_t busUs = 0;   // spent on the bus writing cells
+    uint32_t glyphs = 0;  // custom glyphs loaded into CGRAM
+    void reset() { *this = LcdStats(); }
+};
+
 class Lcd {
 public:
     static constexpr uint8_t COLS = 20;
     static constexpr uint8_t ROWS = 4;
+    // Lines longer than COLS scroll back and forth, a character a step, all
+    // together, pausing at each end. Longer text is cut at MARQUEE_LEN.
+    static constexpr uint8_t MARQUEE_LEN = 64;
+    static constexpr uint16_t MARQUEE_STEP_MS = 350;
+    static constexpr uint8_t MARQUEE_PAUSE_STEPS = 4;
+    // CGRAM slots other than CHAR_UP and CHAR_DOWN, which hold accented
+    // letters (lcd_charset.h) as they are needed, least recently used out
+    static constexpr uint8_t GLYPH_SLOTS = 6;
 
     explicit Lcd(uint8_t i2cAddr);
 
@@ -28,32 +47,100 @@ public:
     // Clear the display
     void clear();
 
-    // Display a single line of text, optionally centered
-    void display_line(const String& text, uint8_t line, bool center = true);
+    // Display a single line of text, optionally centered; too long for the
+    // display, it scrolls (see scroll())
+    void display_line(const char* text, uint8_t line, bool center = true);
+
+    // A scrolling line is due to move on
+    bool scroll_due(uint32_t now) const;
+    // Move the scrolling lines on, if due, rewriting only the cells that change
+    void scroll(uint32_t now);
 
     void display_character(char c, uint8_t line, uint8_t col);
 
     void clear_buffer();
 
-    // Display the "now playing" screen
+    // Display the "now playing" screen. Returns at once if the song, album
+    // and elapsed second are those last drawn, as do repeated album lists.
     void display_playing(const Song* song, const Album* album, uint32_t elapsed);
 
-    // Display the album selection list
-    void display_album_list(const Album* albums, uint16_t albumCount, uint16_t selectedIndex);
+    // Display the album selection list, with the selected album
+    void display_album_list(const Album* selected, uint16_t albumCount, uint16_t selectedIndex);
 
     // Display an initialization/splash screen
-    void display_splash(const String& title, const String& subtitle);
+    void display_splash(const char* title, const char* subtitle);
 
     // Display an error message
-    void display_error(const String& message);
+    void display_error(const char* message);
+
+    // Write changed cells one at a time through the library instead, as
+    // before the batched driver; for comparing the two (host/bench_lcd)
+    void set_batched(const bool batched) { _batched = batched; }
+
+    LcdStats stats;
 
 private:
     Adafruit_LiquidCrystal _lcd;
-    char _buffer[4][20];
+    uint8_t _address;
+    bool _backlight = false;
+    bool _batched = true;
+    uint8_t _burst = 0;    // bytes in the open transaction
+    uint8_t _control = 0;  // RS and backlight pins as last written, 0xFF if unknown
+    char _buffer[4][20];   // as on the display, custom glyphs as their slot
+    char _wanted[4][20];   // as drawn, custom glyphs as their display code
+
+    // Rows are drawn with a slot's code wherever they have its glyph. A glyph
+    // with no slot to spare is drawn as its base letter, and the row drawn
+    // again once another row has let go of a slot.
+    struct GlyphSlot {
+        char glyph = 0;     // display code of the glyph loaded, 0 if none
+        uint16_t used = 0;  // _glyphClock when last drawn
+    };
+    GlyphSlot _glyphs[GLYPH_SLOTS];
+    uint16_t _glyphClock = 0;
+    uint8_t _glyphRetry = 0;  // rows drawn without a glyph, a bit each
+    bool _retrying = false;
+
+    // What the last display_playing() or display_album_list() drew. Album
+    // slots are reused, so the album's catalog index is part of it; anything
+    // else drawn forgets it.
+    struct Drawn {
+        enum class Screen : uint8_t { NONE, PLAYING, ALBUM_LIST };
+        Screen screen = Screen::NONE;
+        const void* item = nullptr;  // song, or selected album
+        uint16_t albumIndex = 0;
+        uint16_t count = 0;          // songs in the album, or albums
+        uint32_t position = 0;       // elapsed second, or selected index
+    };
+    Drawn _drawn;
+
+    struct Marquee {
+        char text[MARQUEE_LEN];
+        uint8_t length = 0;  // 0 if the line is not scrolling
+        uint8_t offset = 0;
+        int8_t direction = 1;
+        uint8_t hold = 0;    // steps left to pause for
+    };
+    Marquee _marquee[4];
+    uint32_t _marqueeNext = 0;
+
+    // Lay text out in a row and draw it, keeping _drawn
+    void draw_line(const char* text, uint8_t line, bool center = true);
+    // Bring row line up to text (COLS characters), writing only what changed
+    void update_row(uint8_t line, const char* text);
+    // The slot code for the glyph's cells, loading it if need be; 0 if every
+    // slot is on screen or taken by this row
+    char glyph_code(char glyph, uint8_t line);
+    void load_glyph(uint8_t slot, char glyph);
+    // Move the cursor to line, col and write length characters of text
+    void write_run(uint8_t line, uint8_t col, const char* text, uint8_t length);
+    void begin_transaction();
+    void end_transaction();
+    void send(uint8_t value, bool data);
     // Display a progress bar showing elapsed/duration
     void display_progress(uint32_t elapsed, uint32_t duration, uint8_t index, uint8_t total, uint8_t line);
-
-
+    bool scrolling() const;
+    void stop_scrolling();
 };
 
 #endif // LCD_H
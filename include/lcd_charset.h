@@ -0,0 +1,50 @@
+//
+// Song and album text is kept in the display's own character codes, decoded
+// and transcoded once when the tags are parsed, so drawing it is a byte copy.
+//
+// The codes are those of the HD44780's A00 (Japanese) character ROM, the one
+// on common 20x4 modules: printable ASCII as is, except '\' and '~' which
+// that ROM lacks; the few accented letters it has (a, o and u with umlaut,
+// n with tilde); and, at 0x80-0x9F, where the ROM is blank, 32 accented
+// letters that are drawn from custom glyphs in CGRAM (see Lcd). Anything
+// else becomes the nearest unaccented ASCII character.
+//
+
+#ifndef BOOMERBOX_LCD_CHARSET_H
+#define BOOMERBOX_LCD_CHARSET_H
+
+#include <Arduino.h>
+
+// Text encodings, numbered as in ID3v2 text frames
+enum class TextEncoding : uint8_t {
+    LATIN1 = 0,
+    UTF16 = 1,    // byte order mark first, big endian without one
+    UTF16BE = 2,
+    UTF8 = 3,
+    UNKNOWN = 4,  // UTF-8 if it is valid UTF-8, otherwise Latin-1
+};
+
+constexpr uint8_t LCD_GLYPH_FIRST = 0x80;
+constexpr uint8_t LCD_GLYPH_COUNT = 32;
+
+// The code stands for a custom glyph
+inline bool isLcdGlyph(const char code) {
+    return static_cast<uint8_t>(static_cast<uint8_t>(code) - LCD_GLYPH_FIRST) < LCD_GLYPH_COUNT;
+}
+
+// Display code for a Unicode code point
+uint8_t lcdCode(uint32_t codepoint);
+
+// The 8 rows of a custom glyph, 5 pixels each
+const uint8_t* lcdGlyphRows(char code);
+
+// The plain ASCII character a display code stands for: its letter without
+// the accent. For sorting, and to draw with when no CGRAM slot is free.
+char lcdBaseChar(char code);
+
+// Decode up to length bytes of text (stopping at a NUL) and write it as
+// display codes to out, NUL terminated, at most size - 1 of them. out may be
+// text itself. Returns the number of codes written.
+size_t lcdTranscode(const char* text, size_t length, TextEncoding encoding, char* out, size_t size);
+
+#endif //BOOMERBOX_LCD_CHARSET_H
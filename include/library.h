@@ -0,0 +1,41 @@
+//
+// Album library: scanning the card and loading album contents on demand.
+//
+
+#ifndef BOOMERBOX_LIBRARY_H
+#define BOOMERBOX_LIBRARY_H
+
+#include <Arduino.h>
+#include <media.h>
+
+// Scan the card for albums, revalidating the on-card catalog
+void scan_songs();
+
+// Number of albums in the library
+uint16_t albumCount();
+
+// Album metadata at a sorted position, or nullptr. Albums are paged in from
+// the catalog; the pointer is only valid until the next albumAt() call.
+const Album* albumAt(uint16_t index);
+
+// Start loading the album at a sorted position for playback, replacing the
+// previously loaded album. Returns nullptr if it could not be loaded.
+// The songs are listed but not yet parsed; see loadAlbumStep().
+Album* loadAlbum(uint16_t index);
+
+// List an album's songs (in filename order) and start parsing them.
+// Until a song is parsed its title is the filename.
+bool beginAlbumLoad(Album* album);
+
+// Parse the next song of the album being loaded. Returns true while there are
+// more; once the last is parsed the songs are sorted into play order, which
+// moves them within the songs array.
+bool loadAlbumStep();
+
+// The album is still being parsed
+bool albumLoadPending(const Album* album);
+
+// Load full song details for an album in one go
+bool loadAlbumSongs(Album* album);
+
+#endif //BOOMERBOX_LIBRARY_H
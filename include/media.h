@@ -6,38 +6,55 @@
 #define BOOMERBOX_MEDIA_H
 
 #include <Arduino.h>
+#include <string_arena.h>
+#include <storage.h>
 
 // Memory limits
-// Each unloaded album uses ~100 bytes (3 Strings + metadata)
-// With ~150KB available heap, 256 albums = ~25KB, leaving plenty for loaded songs
-constexpr uint16_t MAX_ALBUMS = 512;
+// Album metadata lives in the on-card catalog; only a small window of albums
+// around the current selection, plus the playing album's songs, is in RAM.
+// The limit only bounds the temporary sort table used while scanning.
+constexpr uint16_t MAX_ALBUMS = 4096;
 constexpr uint8_t MAX_SONGS_PER_ALBUM = 128;
 constexpr uint8_t MAX_SCAN_DEPTH = 8;
 
+// Album text fields are fixed size, matching the catalog records.
+// With 8.3 names MAX_SCAN_DEPTH levels always fit; with long names (SdFat)
+// albums whose path does not fit are skipped by the scan.
+constexpr uint8_t ALBUM_PATH_LEN = 112;
+constexpr uint8_t ALBUM_TEXT_LEN = 64;
+// Album path, '/' and a filename
+constexpr uint16_t SONG_PATH_LEN = ALBUM_PATH_LEN + STORAGE_NAME_LEN;
+
+// Song text lives in the owning album's arena; look it up with Album::text()
 struct Song {
-    String title;
-    String artist;
-    String album;
-    String filename;
+    TextRef title = 0;
+    TextRef artist = 0;
+    TextRef album = 0;
+    TextRef filename = 0;
     uint32_t duration = 0;
     uint8_t trackNumber = 0;
 };
 
 struct Album {
-    String title;
-    String artist;
-    String path;
+    char title[ALBUM_TEXT_LEN] = "";
+    char artist[ALBUM_TEXT_LEN] = "";
+    char path[ALBUM_PATH_LEN] = "";
+    uint16_t index = 0; // sorted position in the catalog
     Song* songs = nullptr;
+    StringArena strings;
     uint8_t song_count = 0;
     uint8_t expected_song_count = 0;
     bool loaded = false;
-    
-    // Free songs array to reclaim memory
+
+    const char* text(const TextRef ref) const { return strings.at(ref); }
+
+    // Free songs array and song text to reclaim memory
     void unload() {
         if (songs) {
             delete[] songs;
             songs = nullptr;
         }
+        strings.release();
         song_count = 0;
         loaded = false;
     }
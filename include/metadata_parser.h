@@ -3,7 +3,11 @@
 #define METADATA_PARSER_H
 
 #include <Arduino.h>
-#include <SD.h>
+#include <storage.h>
+
+// Longest tag text kept, in display codes with the terminator. Raw text can
+// take twice as many bytes (UTF-16).
+constexpr size_t TAG_TEXT_LEN = 128;
 
 struct SongMetadata {
     String title;
@@ -18,25 +22,25 @@ struct SongMetadata {
 // Returns true if the file was successfully parsed
 // Falls back to filename for title if metadata is missing
 // Note: Does NOT close the file - caller is responsible
-bool parseWavMetadata(File &file, SongMetadata &metadata);
+bool parseWavMetadata(StorageFile &file, SongMetadata &metadata);
 
 // Parse MP3 file metadata (ID3v1 and ID3v2 tags)
 // Returns true if the file was successfully parsed
 // Falls back to filename for title if metadata is missing
 // Note: Does NOT close the file - caller is responsible
-bool parseMp3Metadata(File &file, SongMetadata &metadata);
+bool parseMp3Metadata(StorageFile &file, SongMetadata &metadata);
 
 // Parse OGG Vorbis file metadata (Vorbis comments)
 // Returns true if the file was successfully parsed
 // Falls back to filename for title if metadata is missing
 // Note: Does NOT close the file - caller is responsible
-bool parseOggMetadata(File &file, SongMetadata &metadata);
+bool parseOggMetadata(StorageFile &file, SongMetadata &metadata);
 
 // Generic metadata parser - auto-detects the format based on file extension
 // Supports: WAV, MP3, FLAC, OGG
 // Returns true if the file was successfully parsed
 // Note: Does NOT close the file - caller is responsible
-bool parseMetadata(File &file, SongMetadata &metadata);
+bool parseMetadata(StorageFile &file, SongMetadata &metadata);
 
 // Get the file extension
 // Returns a string, for example, "abc.wav" returns "wav"
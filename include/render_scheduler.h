@@ -0,0 +1,57 @@
+//
+// Decides when the LCD is redrawn, so drawing follows what changed on screen
+// rather than how often the UI task runs.
+//
+
+#ifndef BOOMERBOX_RENDER_SCHEDULER_H
+#define BOOMERBOX_RENDER_SCHEDULER_H
+
+#include <Arduino.h>
+
+// Drawing cost, for profiling
+struct RenderStats {
+    uint32_t frames = 0;
+    uint32_t cells = 0;      // characters written to the display
+    uint32_t busUs = 0;      // spent in I2C transactions
+    uint32_t maxFrameUs = 0;
+    uint32_t coalesced = 0;  // changes drawn by a frame that already had one
+};
+
+// The player reports each change to what is shown with invalidate(); changes
+// are coalesced, and a frame drawn for them no sooner than 1/maxFps after the
+// previous one. Input calls flush() instead, so the next frame is drawn as
+// soon as the UI task runs. Until shouldRender() is true the UI task draws
+// nothing; when it is, it draws the whole screen and reports the frame with
+// rendered(). The Lcd's diff keeps the cells written down to those changed.
+class RenderScheduler {
+public:
+    explicit RenderScheduler(uint8_t maxFps);
+
+    void setMaxFps(uint8_t maxFps);
+
+    // Something shown changed; draw it with the next frame
+    void invalidate();
+    // As invalidate(), but draw it now, regardless of the frame rate
+    void flush();
+
+    // A change is waiting to be drawn
+    bool dirty() const { return _dirty; }
+    bool shouldRender();
+    void rendered(uint32_t cells, uint32_t busUs, uint32_t frameUs);
+
+    // Frames, cells and I2C time per second since the last reset, worst frame
+    // and changes coalesced
+    void report(Print& out);
+    void resetStats();
+
+private:
+    uint16_t _intervalMs = 0;
+    uint32_t _lastFrame = 0;
+    bool _dirty = true;  // nothing has been drawn yet
+    bool _urgent = false;
+    uint16_t _changes = 0;
+    uint32_t _statsSince = 0;
+    RenderStats _stats;
+};
+
+#endif //BOOMERBOX_RENDER_SCHEDULER_H
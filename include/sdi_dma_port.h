@@ -0,0 +1,57 @@
+//
+// SdiPort over the board's DMA controller, on the boards that have one the
+// player supports: SAMD51 (Feather M4) and RP2040 built with
+// -D AUDIO_SINGLE_CORE. Elsewhere, or with -D SDI_DMA_DISABLE, stream data is
+// sent by the CPU through Vs1053Output; on a dual-core RP2040 that is core1's
+// whole job (audio_core.h).
+//
+
+#ifndef BOOMERBOX_SDI_DMA_PORT_H
+#define BOOMERBOX_SDI_DMA_PORT_H
+
+#include <Arduino.h>
+#include <sdi_scheduler.h>
+#include <audio_core.h>
+
+#if (defined(__SAMD51__) || (defined(ARDUINO_ARCH_RP2040) && !defined(AUDIO_CORE1))) && !defined(SDI_DMA_DISABLE)
+#define SDI_DMA_SUPPORTED
+#endif
+
+#ifdef SDI_DMA_SUPPORTED
+
+#ifdef __SAMD51__
+#include <Adafruit_ZeroDMA.h>
+#endif
+
+// Writes each burst from memory to the SPI data register, paced by the SPI
+// peripheral, with the VS1053's data select (XDCS) held low. The DMA
+// interrupt fires once the last byte has been handed to the SPI peripheral;
+// endBurst() waits for it to be shifted out before deselecting, and drops
+// the bytes clocked in meanwhile so the card's next read does not see them.
+class SdiDmaPort : public SdiPort {
+public:
+    SdiDmaPort(uint8_t dcsPin, uint8_t dreqPin) : _dcsPin(dcsPin), _dreqPin(dreqPin) {}
+
+    // Claim a DMA channel; completed bursts are reported to sdi. Call after
+    // the VS1053 has been set up.
+    bool begin(SdiScheduler& sdi);
+
+    bool dreq() override { return digitalRead(_dreqPin); }
+    void startBurst(const uint8_t* data, uint8_t length) override;
+    bool burstBusy() override;
+    void endBurst() override;
+
+private:
+    uint8_t _dcsPin;
+    uint8_t _dreqPin;
+#ifdef __SAMD51__
+    Adafruit_ZeroDMA _dma;
+    DmacDescriptor* _descriptor = nullptr;
+#else
+    int _channel = -1;
+#endif
+};
+
+#endif
+
+#endif //BOOMERBOX_SDI_DMA_PORT_H
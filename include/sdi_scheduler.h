@@ -0,0 +1,84 @@
+//
+// Sends decoder stream data (SDI) in DMA bursts, sharing the SPI bus with
+// the card. The hardware end is an SdiPort (sdi_dma_port.h on the device,
+// a model on the host).
+//
+
+#ifndef BOOMERBOX_SDI_SCHEDULER_H
+#define BOOMERBOX_SDI_SCHEDULER_H
+
+#include <Arduino.h>
+
+class SdiPort {
+public:
+    // VS1053 DREQ: at least 32 bytes of room
+    virtual bool dreq() = 0;
+
+    // Select the data interface and start sending by DMA. The port calls
+    // SdiScheduler::complete() from its DMA interrupt when the last byte is out.
+    virtual void startBurst(const uint8_t* data, uint8_t length) = 0;
+
+    // The burst is still being clocked out
+    virtual bool burstBusy() = 0;
+
+    // Deselect and let go of the bus
+    virtual void endBurst() = 0;
+
+protected:
+    ~SdiPort() = default;
+};
+
+// One burst is in flight at a time; it is started from feed() (DREQ or
+// loop()) and its completion interrupt calls the idle callback, which feeds
+// the next one, so a full decoder buffer is refilled without loop() or the
+// CPU moving the bytes.
+//
+// Anything else on the bus claims it first: claimBus() tops the decoder up,
+// waits out the burst in flight and holds new ones off until releaseBus().
+// Register access to the decoder only needs finish(), as it is made from
+// feed() or with feed() held off.
+class SdiScheduler {
+public:
+    static constexpr uint8_t BURST_SIZE = 32;
+
+    explicit SdiScheduler(SdiPort& port) : _port(port) {}
+
+    // Called when a burst completes or the bus is released, to send more
+    void onIdle(void (*callback)()) { _onIdle = callback; }
+
+    // A burst can start now
+    bool ready() { return !_active && _claims == 0 && _port.dreq(); }
+
+    // Start sending up to BURST_SIZE bytes. The data is copied, so the
+    // caller's buffer can be reused straight away.
+    void send(const uint8_t* data, uint8_t length);
+
+    // From the port's DMA interrupt
+    void complete();
+
+    // Wait for the burst in flight, if any, to finish
+    void finish();
+
+    // Keep bursts off the bus while it is used for something else. Nests.
+    // Not for use from interrupts.
+    void claimBus();
+    void releaseBus();
+
+    // Totals, for profiling
+    uint32_t bursts() const { return _bursts; }
+    uint32_t claimWaits() const { return _claimWaits; }
+
+private:
+    bool end();
+    void topUp();
+
+    SdiPort& _port;
+    void (*_onIdle)() = nullptr;
+    uint8_t _buffer[BURST_SIZE] = {};
+    volatile bool _active = false;
+    volatile uint8_t _claims = 0;
+    uint32_t _bursts = 0;
+    uint32_t _claimWaits = 0;
+};
+
+#endif //BOOMERBOX_SDI_SCHEDULER_H
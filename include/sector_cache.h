@@ -0,0 +1,55 @@
+//
+// Small LRU cache of recently read file sectors, shared by every BlockReader.
+//
+
+#ifndef BOOMERBOX_SECTOR_CACHE_H
+#define BOOMERBOX_SECTOR_CACHE_H
+
+#include <Arduino.h>
+#include <storage.h>
+
+// Hit/miss totals, for profiling
+struct SectorCacheStats {
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+
+    void reset() { *this = SectorCacheStats(); }
+};
+
+// Keeps the last few 512-byte sectors read, keyed by the open file's id and
+// the sector's index in the file (file data starts on a card sector, so these
+// are whole card sectors). The metadata parsers jump between the tags at the
+// start and end of a file and the frames in between; with the cache, going
+// back to a sector already read costs no card access, including across
+// parse calls on the same open file.
+//
+// Returned data stays valid until the next read(), so only one reader may
+// use the cache at a time. Not for use from interrupts.
+class SectorCache {
+public:
+    static constexpr uint16_t SECTOR_SIZE = 512;
+    static constexpr uint8_t CAPACITY = 8;
+
+    // Sector number sector of file, or nullptr if it could not be read.
+    // length is set to the bytes available, less than SECTOR_SIZE only for
+    // the last sector of the file.
+    const uint8_t* read(StorageFile& file, uint32_t sector, uint16_t& length);
+
+    SectorCacheStats stats;
+
+private:
+    struct Slot {
+        uint32_t fileId = 0;  // 0 = empty
+        uint32_t sector = 0;
+        uint32_t lastUse = 0;
+        uint16_t length = 0;
+    };
+
+    Slot _slots[CAPACITY];
+    uint8_t _data[CAPACITY][SECTOR_SIZE];
+    uint32_t _clock = 0;
+};
+
+extern SectorCache sector_cache;
+
+#endif //BOOMERBOX_SECTOR_CACHE_H
@@ -0,0 +1,61 @@
+//
+// In-place sorting helpers shared by the album and song sorts.
+//
+
+#ifndef BOOMERBOX_SORT_H
+#define BOOMERBOX_SORT_H
+
+#include <Arduino.h>
+
+// Heap sort: O(n log n) comparisons, no recursion and no extra memory.
+// Not stable, so comparators should break ties themselves.
+// less(a, b) returns true if a sorts before b.
+template<typename T, typename Less>
+void heapSort(T* items, const uint16_t count, Less less) {
+    if (count < 2) return;
+
+    // Move items[root] down until both children sort before it
+    auto siftDown = [&](uint16_t root, const uint16_t end) {
+        while (true) {
+            uint32_t child = 2u * root + 1;
+            if (child >= end) return;
+            if (child + 1 < end && less(items[child], items[child + 1])) child++;
+            if (!less(items[root], items[child])) return;
+            const T temp = items[root];
+            items[root] = items[child];
+            items[child] = temp;
+            root = child;
+        }
+    };
+
+    for (uint16_t i = count / 2; i > 0; i--) {
+        siftDown(i - 1, count);
+    }
+    for (uint16_t end = count - 1; end > 0; end--) {
+        const T temp = items[0];
+        items[0] = items[end];
+        items[end] = temp;
+        siftDown(0, end);
+    }
+}
+
+// Reorder items so that items[i] becomes the old items[order[i]].
+// Each item is moved once; order is left as the identity.
+template<typename T, typename Index>
+void applyPermutation(T* items, Index* order, const uint16_t count) {
+    for (uint16_t i = 0; i < count; i++) {
+        if (order[i] == i) continue;
+        const T temp = items[i];
+        uint16_t j = i;
+        while (order[j] != i) {
+            const uint16_t next = order[j];
+            items[j] = items[next];
+            order[j] = j;
+            j = next;
+        }
+        items[j] = temp;
+        order[j] = j;
+    }
+}
+
+#endif //BOOMERBOX_SORT_H
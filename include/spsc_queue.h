@@ -0,0 +1,51 @@
+//
+// Fixed-size lock-free queue between exactly one producer and one consumer,
+// which may run on different cores (or an interrupt and the code it
+// interrupts).
+//
+
+#ifndef BOOMERBOX_SPSC_QUEUE_H
+#define BOOMERBOX_SPSC_QUEUE_H
+
+#include <atomic>
+#include <stdint.h>
+
+// The producer owns _head and the consumer _tail; each only reads the
+// other's. An item is written before _head is published (release) and read
+// after _head is seen (acquire), so it is never read half written. Both are
+// free-running counts, wrapping at 2^32, so all SIZE slots are usable.
+template<typename T, uint8_t SIZE>
+class SpscQueue {
+    static_assert(SIZE > 0 && (SIZE & (SIZE - 1)) == 0, "SIZE must be a power of two");
+
+public:
+    // Producer only. False if the queue is full.
+    bool push(const T& item) {
+        const uint32_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) == SIZE) return false;
+        _items[head & (SIZE - 1)] = item;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. False if the queue is empty.
+    bool pop(T& item) {
+        const uint32_t tail = _tail.load(std::memory_order_relaxed);
+        if (_head.load(std::memory_order_acquire) == tail) return false;
+        item = _items[tail & (SIZE - 1)];
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Either side; only a hint, as the other side may be changing it
+    bool empty() const {
+        return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+    }
+
+private:
+    T _items[SIZE];
+    std::atomic<uint32_t> _head{0};
+    std::atomic<uint32_t> _tail{0};
+};
+
+#endif //BOOMERBOX_SPSC_QUEUE_H
@@ -0,0 +1,209 @@
+//
+// Card storage, with the backend chosen at build time:
+//   default                  arduino-libraries/SD (FAT16/FAT32, 8.3 names)
+//   -D STORAGE_SDFAT         greiman/SdFat (FAT16/FAT32 and exFAT, long names)
+//
+// StorageFile covers what the player needs from a file or directory. With
+// SdFat, directory entries are opened in place into a reused StorageFile,
+// which reads the entry's name and attributes without allocating anything.
+//
+
+#ifndef BOOMERBOX_STORAGE_H
+#define BOOMERBOX_STORAGE_H
+
+#include <Arduino.h>
+
+#ifdef STORAGE_SDFAT
+#include <SdFat.h>
+#else
+#include <SD.h>
+#endif
+
+// Longest file name the backend can return, with the terminator
+#ifdef STORAGE_SDFAT
+constexpr uint8_t STORAGE_NAME_LEN = 64;
+#else
+constexpr uint8_t STORAGE_NAME_LEN = 13; // 8.3
+#endif
+
+enum class StorageMode : uint8_t {
+    READ,
+    WRITE, // create if missing, writes append
+};
+
+// Set on boards that use the SPI bus for something else in the background
+// (sdi_scheduler.h): claim is called before every card access and release
+// after it
+struct StorageBus {
+    void (*claim)() = nullptr;
+    void (*release)() = nullptr;
+};
+
+extern StorageBus storage_bus;
+
+class StorageBusLock {
+public:
+    StorageBusLock() {
+        if (storage_bus.claim) storage_bus.claim();
+    }
+    ~StorageBusLock() {
+        if (storage_bus.release) storage_bus.release();
+    }
+    StorageBusLock(const StorageBusLock&) = delete;
+    StorageBusLock& operator=(const StorageBusLock&) = delete;
+};
+
+class StorageFile {
+public:
+    StorageFile() = default;
+
+    explicit operator bool() { return isOpen(); }
+
+    // Changes every time a file is opened, and is shared by copies of the
+    // open file, so caches can tell files apart. 0 when closed.
+    uint32_t id() const { return _id; }
+
+#ifdef STORAGE_SDFAT
+    bool isOpen() { return _file.isOpen(); }
+    int read(void* buf, const uint16_t count) {
+        const StorageBusLock lock;
+        return _file.read(buf, count);
+    }
+    size_t write(const uint8_t* buf, const size_t count) {
+        const StorageBusLock lock;
+        return _file.write(buf, count);
+    }
+    bool seek(const uint32_t pos) {
+        const StorageBusLock lock;
+        return _file.seekSet(pos);
+    }
+    uint32_t position() { return static_cast<uint32_t>(_file.curPosition()); }
+    uint32_t size() { return static_cast<uint32_t>(_file.fileSize()); }
+    void flush() {
+        const StorageBusLock lock;
+        _file.sync();
+    }
+    void close() {
+        const StorageBusLock lock;
+        _file.close();
+        _id = 0;
+    }
+    bool isDirectory() { return _file.isDir(); }
+    // Last modification time as FAT date and time (date << 16 | time), 0 if unknown
+    uint32_t modified() {
+        const StorageBusLock lock;
+        uint16_t date = 0;
+        uint16_t time = 0;
+        if (!_file.getModifyDateTime(&date, &time)) return 0;
+        return static_cast<uint32_t>(date) << 16 | time;
+    }
+    // Long names are read from the directory
+    bool getName(char* name, const size_t size) {
+        const StorageBusLock lock;
+        const size_t length = _file.getName(name, size);
+        return length > 0 && length < size;
+    }
+    void rewindDirectory() { _file.rewind(); }
+    bool openNext(StorageFile& dir) {
+        close();
+        const StorageBusLock lock;
+        if (!_file.openNext(&dir._file, O_RDONLY)) return false;
+        _id = ++_lastId;
+        return true;
+    }
+#else
+    bool isOpen() { return static_cast<bool>(_file); }
+    int read(void* buf, const uint16_t count) {
+        const StorageBusLock lock;
+        return _file.read(buf, count);
+    }
+    size_t write(const uint8_t* buf, const size_t count) {
+        const StorageBusLock lock;
+        return _file.write(buf, count);
+    }
+    bool seek(const uint32_t pos) {
+        const StorageBusLock lock;
+        return _file.seek(pos);
+    }
+    uint32_t position() { return _file.position(); }
+    uint32_t size() { return _file.size(); }
+    void flush() {
+        const StorageBusLock lock;
+        _file.flush();
+    }
+    void close() {
+        const StorageBusLock lock;
+        if (_file) _file.close();
+        _id = 0;
+    }
+    bool isDirectory() { return _file.isDirectory(); }
+    // The SD library keeps no timestamps; the host stand-in does
+    uint32_t modified() {
+#ifdef SD_FILE_MODIFIED
+        return _file.modified();
+#else
+        return 0;
+#endif
+    }
+    bool getName(char* name, const size_t size) {
+        const char* entryName = _file.name();
+        const size_t length = strlen(entryName);
+        if (length == 0 || length >= size) return false;
+        memcpy(name, entryName, length + 1);
+        return true;
+    }
+    void rewindDirectory() { _file.rewindDirectory(); }
+    // The SD library allocates every entry it opens, so the previous one is
+    // closed first
+    bool openNext(StorageFile& dir) {
+        close();
+        const StorageBusLock lock;
+        _file = dir._file.openNextFile();
+        if (!_file) return false;
+        _id = ++_lastId;
+        return true;
+    }
+#endif
+
+    // Take over other's open file, leaving other closed
+    void take(StorageFile& other) {
+        close();
+        _file = other._file;
+        _id = other._id;
+#ifdef STORAGE_SDFAT
+        other._file.close();
+#else
+        other._file = File();
+#endif
+        other._id = 0;
+    }
+
+private:
+    friend class Storage;
+
+    static uint32_t _lastId;
+    uint32_t _id = 0;
+
+#ifdef STORAGE_SDFAT
+    FsFile _file;
+#else
+    File _file;
+#endif
+};
+
+class Storage {
+public:
+    // Mount the card on the SPI bus with chip select csPin
+    bool begin(uint8_t csPin);
+
+    StorageFile open(const char* path, StorageMode mode = StorageMode::READ);
+    bool exists(const char* path);
+    bool remove(const char* path);
+
+    // "FAT16", "FAT32" or "exFAT", for the log
+    const char* volumeType();
+};
+
+extern Storage storage;
+
+#endif //BOOMERBOX_STORAGE_H
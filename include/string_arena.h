@@ -0,0 +1,71 @@
+//
+// Per-album text storage for song metadata.
+//
+
+#ifndef BOOMERBOX_STRING_ARENA_H
+#define BOOMERBOX_STRING_ARENA_H
+
+#include <Arduino.h>
+
+// Offset of a string in a StringArena. 0 is always the empty string.
+typedef uint16_t TextRef;
+
+// All of an album's song text in one contiguous heap block, so loading and
+// unloading an album is a single allocation and a single free rather than
+// four String allocations per song.
+//
+// Strings are referred to by offset, which stays valid when the block grows.
+class StringArena {
+public:
+    StringArena() = default;
+    // The block has a single owner; copies would free it twice
+    StringArena(const StringArena&) = delete;
+    StringArena& operator=(const StringArena&) = delete;
+
+    // Allocate room for capacity bytes of text. Returns false if out of memory.
+    bool reserve(uint16_t capacity);
+
+    // Copy a string into the arena. Returns 0 (the empty string) if it does not fit.
+    TextRef add(const char* text, size_t length);
+    TextRef add(const char* text) { return add(text, strlen(text)); }
+
+    const char* at(const TextRef ref) const { return _data && ref < _size ? _data + ref : ""; }
+
+    // Give back unused capacity once the album is loaded
+    void shrink();
+
+    // Free the whole block
+    void release();
+
+    uint16_t size() const { return _size; }
+    uint16_t capacity() const { return _capacity; }
+
+private:
+    bool grow(uint32_t needed);
+
+    char* _data = nullptr;
+    uint16_t _size = 0;
+    uint16_t _capacity = 0;
+};
+
+// Stores repeated strings (artist and album names, which every track of an
+// album usually shares) only once. Used while an album is being loaded.
+class StringInterner {
+public:
+    StringInterner() = default;
+    explicit StringInterner(StringArena& arena) { reset(arena); }
+
+    // Start over on an arena
+    void reset(StringArena& arena);
+
+    TextRef intern(const char* text);
+    TextRef intern(const String& text) { return intern(text.c_str()); }
+
+private:
+    static constexpr uint8_t SLOTS = 32;
+
+    StringArena* _arena = nullptr;
+    TextRef _slots[SLOTS] = {}; // 0 = empty slot
+};
+
+#endif //BOOMERBOX_STRING_ARENA_H
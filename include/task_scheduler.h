@@ -0,0 +1,83 @@
+//
+// Cooperative scheduler for the work loop() does: each pass runs the most
+// urgent task that is due, and tasks never block.
+//
+
+#ifndef BOOMERBOX_TASK_SCHEDULER_H
+#define BOOMERBOX_TASK_SCHEDULER_H
+
+#include <Arduino.h>
+
+// Non-blocking stand-in for delay(): start it, then check it from a task
+class Timeout {
+public:
+    void start(const uint32_t ms) {
+        _end = millis() + ms;
+        _running = true;
+    }
+
+    void cancel() { _running = false; }
+
+    // True once the time is up (and if it was never started)
+    bool expired() {
+        if (_running && static_cast<int32_t>(millis() - _end) >= 0) _running = false;
+        return !_running;
+    }
+
+private:
+    uint32_t _end = 0;
+    bool _running = false;
+};
+
+// Time spent in a task, for profiling
+struct TaskStats {
+    uint32_t runs = 0;
+    uint32_t totalUs = 0;
+    uint32_t maxUs = 0;
+    uint32_t missed = 0; // started after the next period was already due
+};
+
+// Periodic tasks are due every periodMs; each one's deadline is the start of
+// its next period, and of the tasks that are due the one with the earliest
+// deadline runs first (earliest deadline first), priority breaking ties, lower
+// first. Tasks with period 0 are background work: they run, in turn, only
+// when no periodic task is due.
+//
+// A task that runs late is counted as missed and is not run again to catch
+// up; its next period starts from when it did run.
+class TaskScheduler {
+public:
+    static constexpr uint8_t MAX_TASKS = 8;
+
+    // Returns the task's index, or -1 if there is no room
+    int8_t add(const char* name, void (*run)(), uint16_t periodMs, uint8_t priority);
+
+    // Run the most urgent task that is due. Returns false if none was.
+    bool runNext();
+
+    // Make a periodic task due now, e.g. to redraw right after input
+    void wake(int8_t task);
+
+    // One line per task: runs, mean and worst run time, missed deadlines
+    void report(Print& out);
+    void resetStats();
+
+private:
+    struct Task {
+        const char* name = nullptr;
+        void (*run)() = nullptr;
+        uint16_t periodMs = 0;
+        uint8_t priority = 0;
+        uint32_t due = 0;
+        bool started = false;
+        TaskStats stats;
+    };
+
+    void runTask(Task& task, uint32_t now);
+
+    Task _tasks[MAX_TASKS];
+    uint8_t _count = 0;
+    uint8_t _nextBackground = 0;
+};
+
+#endif //BOOMERBOX_TASK_SCHEDULER_H
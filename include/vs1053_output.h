@@ -0,0 +1,95 @@
+//
+// AudioOutput over the VS1053 codec (device builds only).
+//
+
+#ifndef BOOMERBOX_VS1053_OUTPUT_H
+#define BOOMERBOX_VS1053_OUTPUT_H
+
+#include <Adafruit_VS1053.h>
+#include <audio_feeder.h>
+#include <sdi_scheduler.h>
+
+// Decoder mode used for playback, as set by Adafruit_VS1053_FilePlayer
+constexpr uint16_t VS1053_PLAY_MODE = VS1053_MODE_SM_LINE1 | VS1053_MODE_SM_SDINEW | VS1053_MODE_SM_LAYER12;
+
+class Vs1053Output : public AudioOutput {
+public:
+    explicit Vs1053Output(Adafruit_VS1053& codec) : _codec(codec) {}
+
+    bool readyForData() override { return _codec.readyForData(); }
+
+    void playData(uint8_t* data, const uint8_t length) override { _codec.playData(data, length); }
+
+    // Same register writes as Adafruit_VS1053_FilePlayer::startPlayingFile()
+    void beginStream() override {
+        _codec.sciWrite(VS1053_REG_MODE, VS1053_PLAY_MODE);
+        // Resync
+        _codec.sciWrite(VS1053_REG_WRAMADDR, 0x1e29);
+        _codec.sciWrite(VS1053_REG_WRAM, 0);
+        // Written twice to reset the decode time, per the datasheet
+        _codec.sciWrite(VS1053_REG_DECODETIME, 0x00);
+        _codec.sciWrite(VS1053_REG_DECODETIME, 0x00);
+    }
+
+    uint8_t endFillByte() override {
+        _codec.sciWrite(VS1053_REG_WRAMADDR, 0x1e06);
+        return _codec.sciRead(VS1053_REG_WRAM) & 0xFF;
+    }
+
+    void requestCancel() override {
+        _codec.sciWrite(VS1053_REG_MODE, VS1053_PLAY_MODE | VS1053_MODE_SM_CANCEL);
+    }
+
+    bool cancelPending() override {
+        return _codec.sciRead(VS1053_REG_MODE) & VS1053_MODE_SM_CANCEL;
+    }
+
+    // From loop()
+    void setVolume(const uint8_t left, const uint8_t right) { _codec.setVolume(left, right); }
+
+private:
+    Adafruit_VS1053& _codec;
+};
+
+// Stream data goes out in DMA bursts through sdi (sdi_dma_port.h). Register
+// access waits for the burst in flight: from feed() no new one can start
+// meanwhile, and from loop() bursts are held off until it is done.
+class Vs1053DmaOutput : public Vs1053Output {
+public:
+    Vs1053DmaOutput(Adafruit_VS1053& codec, SdiScheduler& sdi) : Vs1053Output(codec), _sdi(sdi) {}
+
+    bool readyForData() override { return _sdi.ready(); }
+
+    void playData(uint8_t* data, const uint8_t length) override { _sdi.send(data, length); }
+
+    void beginStream() override {
+        _sdi.finish();
+        Vs1053Output::beginStream();
+    }
+
+    uint8_t endFillByte() override {
+        _sdi.finish();
+        return Vs1053Output::endFillByte();
+    }
+
+    void requestCancel() override {
+        _sdi.finish();
+        Vs1053Output::requestCancel();
+    }
+
+    bool cancelPending() override {
+        _sdi.finish();
+        return Vs1053Output::cancelPending();
+    }
+
+    void setVolume(const uint8_t left, const uint8_t right) {
+        _sdi.claimBus();
+        Vs1053Output::setVolume(left, right);
+        _sdi.releaseBus();
+    }
+
+private:
+    SdiScheduler& _sdi;
+};
+
+#endif //BOOMERBOX_VS1053_OUTPUT_H
@@ -0,0 +1,92 @@
+#include "audio_core.h"
+
+AudioCore::AudioCore(AudioFeeder& feeder, AudioOutput& output, void (*setVolume)(uint8_t))
+    : _feeder(feeder), _output(output), _setVolume(setVolume) {
+}
+
+bool AudioCore::play(const char* path) {
+    return post(AudioCommand::Type::PLAY, path);
+}
+
+bool AudioCore::queue(const char* path) {
+    return post(AudioCommand::Type::QUEUE, path);
+}
+
+bool AudioCore::clearQueue() {
+    return post(AudioCommand::Type::CLEAR_QUEUE);
+}
+
+bool AudioCore::pause(const bool paused) {
+    return post(paused ? AudioCommand::Type::PAUSE : AudioCommand::Type::RESUME);
+}
+
+bool AudioCore::stop() {
+    return post(AudioCommand::Type::STOP);
+}
+
+bool AudioCore::setVolume(const uint8_t volume) {
+    return post(AudioCommand::Type::VOLUME, nullptr, volume);
+}
+
+bool AudioCore::post(const AudioCommand::Type type, const char* path, const uint8_t volume) {
+    _next.type = type;
+    _next.volume = volume;
+    _next.path[0] = '\0';
+    if (path) {
+        strncpy(_next.path, path, sizeof(_next.path) - 1);
+        _next.path[sizeof(_next.path) - 1] = '\0';
+    }
+
+    if (_inline) return run(_next);
+    if (!_commands.push(_next)) return false;
+    _posted++;
+    return true;
+}
+
+bool AudioCore::hasWork() {
+    if (!_commands.empty() || _feeder.needsFill()) return true;
+    return _feeder.playing() && !_feeder.paused() && _output.readyForData();
+}
+
+void AudioCore::service() {
+    AudioCommand command;
+    while (_commands.pop(command)) {
+        run(command);
+        _done.store(_done.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    // Top the decoder up before the card reads as well as after, for boards
+    // where nothing feeds it from an interrupt while they run
+    _feeder.feed();
+    _feeder.fill();
+    _feeder.feed();
+}
+
+bool AudioCore::run(const AudioCommand& command) {
+    bool ok = true;
+    switch (command.type) {
+        case AudioCommand::Type::PLAY:
+            ok = _feeder.play(command.path);
+            break;
+        case AudioCommand::Type::QUEUE:
+            ok = _feeder.queue(command.path);
+            break;
+        case AudioCommand::Type::CLEAR_QUEUE:
+            _feeder.clearQueue();
+            break;
+        case AudioCommand::Type::PAUSE:
+            _feeder.pause(true);
+            break;
+        case AudioCommand::Type::RESUME:
+            _feeder.pause(false);
+            break;
+        case AudioCommand::Type::STOP:
+            _feeder.stop();
+            break;
+        case AudioCommand::Type::VOLUME:
+            _setVolume(command.volume);
+            break;
+    }
+    // Only ever counted on one side
+    if (!ok) _failures.store(_failures.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return ok;
+}
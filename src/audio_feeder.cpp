@@ -0,0 +1,273 @@
+#include "audio_feeder.h"
+
+static StreamFormat formatOf(const char* path) {
+    const char* dot = strrchr(path, '.');
+    if (!dot) return StreamFormat::OTHER;
+    if (strcasecmp(dot, ".mp3") == 0) return StreamFormat::MP3;
+    if (strcasecmp(dot, ".ogg") == 0) return StreamFormat::OGG;
+    if (strcasecmp(dot, ".wav") == 0) return StreamFormat::WAV;
+    return StreamFormat::OTHER;
+}
+
+// Size of a leading ID3v2 tag, which the decoder would otherwise have to
+// read through (cover art can be hundreds of KB)
+static uint32_t id3v2Size(StorageFile& file) {
+    uint8_t header[10];
+    if (file.read(header, sizeof(header)) != sizeof(header) ||
+        header[0] != 'I' || header[1] != 'D' || header[2] != '3') {
+        return 0;
+    }
+    uint32_t size = (static_cast<uint32_t>(header[6] & 0x7F) << 21) |
+                    (static_cast<uint32_t>(header[7] & 0x7F) << 14) |
+                    (static_cast<uint32_t>(header[8] & 0x7F) << 7) |
+                    (header[9] & 0x7F);
+    size += 10;
+    if (header[5] & 0x10) size += 10; // footer
+    return size;
+}
+
+AudioFeeder::AudioFeeder(AudioOutput& output) : _output(output) {
+}
+
+bool AudioFeeder::open(const char* path, StorageFile& file, StreamFormat& format) {
+    file = storage.open(path);
+    if (!file) {
+        Serial.print("Failed to open: ");
+        Serial.println(path);
+        return false;
+    }
+
+    format = formatOf(path);
+    const uint32_t start = format == StreamFormat::MP3 ? id3v2Size(file) : 0;
+    if (!file.seek(start < file.size() ? start : 0)) {
+        file.close();
+        return false;
+    }
+    return true;
+}
+
+// Put an opened file in a track slot. Called with feed() held off.
+void AudioFeeder::install(Track& track, StorageFile& file, const StreamFormat format) {
+    track.file.take(file);
+    track.format = format;
+    track.end = 0;
+    track.ended = false;
+    track.ready = true;
+}
+
+void AudioFeeder::close(Track& track) {
+    track.file.close();
+    track.ended = false;
+    track.ready = false;
+}
+
+void AudioFeeder::release() {
+    _busy = false;
+    // A DREQ that came meanwhile was only noted; the decoder may not raise
+    // another until it is fed
+    if (_pending) feed();
+}
+
+bool AudioFeeder::play(const char* path) {
+    stop();
+
+    StorageFile file;
+    StreamFormat format;
+    if (!open(path, file, format)) return false;
+
+    // Fill the ring before the first DREQ, so starting does not wait on the card
+    _busy = true;
+    install(_tracks[0], file, format);
+    _output.beginStream();
+    _paused = false;
+    _starved = false;
+    _state = State::STREAMING;
+    fill();
+    _busy = false;
+
+    // Fill the decoder's buffer right away
+    feed();
+    return true;
+}
+
+bool AudioFeeder::queue(const char* path) {
+    clearQueue();
+
+    // feed() keeps draining the ring while the file is opened
+    StorageFile file;
+    StreamFormat format;
+    if (!open(path, file, format)) return false;
+
+    _busy = true;
+    const uint8_t next = _playing ^ 1;
+    install(_tracks[next], file, format);
+    // fill() moves on to the queued track when the current file ends; if it
+    // already has, nothing else would
+    if (!_tracks[_reading].file) _reading = next;
+    release();
+
+    fill();
+    return true;
+}
+
+void AudioFeeder::clearQueue() {
+    _busy = true;
+    Track& next = _tracks[_playing ^ 1];
+    if (next.ready && _reading != _playing) {
+        // Drop what was already read ahead of the queued track. The playing
+        // file has been read to its end, so reading stays on the queued
+        // track's slot for whatever is queued next.
+        _head = _tracks[_playing].end;
+    }
+    close(next);
+    release();
+}
+
+void AudioFeeder::stop() {
+    _busy = true;
+    if (_state != State::IDLE) {
+        _output.requestCancel();
+    }
+    close(_tracks[0]);
+    close(_tracks[1]);
+    _playing = 0;
+    _reading = 0;
+    _head = 0;
+    _tail = 0;
+    _state = State::IDLE;
+    _paused = false;
+    release();
+}
+
+void AudioFeeder::pause(const bool paused) {
+    _paused = paused;
+    if (!paused) feed();
+}
+
+void AudioFeeder::fill() {
+    while (_state != State::IDLE) {
+        Track& track = _tracks[_reading];
+        // Everything queued has been read
+        if (!track.file) return;
+
+        // Whole reads only, straight into the ring
+        const uint16_t offset = _head & (RING_SIZE - 1);
+        if (RING_SIZE - (_head - _tail) < READ_SIZE) return;
+        const uint16_t length = min(READ_SIZE, static_cast<uint16_t>(RING_SIZE - offset));
+        const int bytesRead = track.file.read(_ring + offset, length);
+        if (bytesRead > 0) {
+            _head += bytesRead;
+            continue;
+        }
+
+        // End of the file: the next track's data follows in the ring
+        track.file.close();
+        track.end = _head;
+        track.ended = true;
+        Track& other = _tracks[_reading ^ 1];
+        if (!other.ready || !other.file) return;
+        _reading ^= 1;
+    }
+}
+
+void AudioFeeder::feed() {
+    // Already feeding (called from the DREQ interrupt during loop()'s call),
+    // or loop() is changing tracks. With an output that finishes in the
+    // background, the call in progress may have stopped before that output
+    // came ready again, so it is asked to go round once more.
+    if (_busy || _paused) {
+        _pending = true;
+        return;
+    }
+    _busy = true;
+    do {
+        _pending = false;
+        while (_state != State::IDLE && _output.readyForData()) {
+            if (!feedChunk()) break;
+        }
+    } while (_pending && !_paused);
+    _busy = false;
+}
+
+// Make the queued track current
+void AudioFeeder::startNext() {
+    _playing ^= 1;
+    _starved = false;
+    _state = State::STREAMING;
+    _advances++;
+}
+
+bool AudioFeeder::feedChunk() {
+    switch (_state) {
+        case State::STREAMING: {
+            Track& track = _tracks[_playing];
+            uint32_t available = _head - _tail;
+            if (track.ended && track.end - _tail < available) {
+                available = track.end - _tail;
+            }
+            if (available == 0) {
+                if (!track.ended) {
+                    // The ring ran dry before the file did
+                    if (!_starved) _underruns++;
+                    _starved = true;
+                    return false;
+                }
+                // End of the track
+                Track& next = _tracks[_playing ^ 1];
+                const bool splice = next.ready &&
+                                    track.format == StreamFormat::MP3 &&
+                                    next.format == StreamFormat::MP3;
+                track.ready = false;
+                if (splice) {
+                    startNext();
+                } else {
+                    _fillByte = _output.endFillByte();
+                    _fillSent = 0;
+                    _state = State::END_FILL;
+                }
+                return true;
+            }
+            _starved = false;
+            const uint16_t offset = _tail & (RING_SIZE - 1);
+            const uint16_t length = min(min(available, static_cast<uint32_t>(CHUNK_SIZE)),
+                                        static_cast<uint32_t>(RING_SIZE - offset));
+            _output.playData(_ring + offset, length);
+            _tail += length;
+            return true;
+        }
+
+        case State::END_FILL: {
+            uint8_t fill[CHUNK_SIZE];
+            memset(fill, _fillByte, sizeof(fill));
+            _output.playData(fill, sizeof(fill));
+            _fillSent += sizeof(fill);
+            if (_fillSent >= END_FILL_BYTES) {
+                _output.requestCancel();
+                _fillSent = 0;
+                _state = State::CANCELLING;
+            }
+            return true;
+        }
+
+        case State::CANCELLING: {
+            if (!_output.cancelPending() || _fillSent >= CANCEL_FILL_BYTES) {
+                if (_tracks[_playing ^ 1].ready) {
+                    _output.beginStream();
+                    startNext();
+                    return true;
+                }
+                _state = State::IDLE;
+                return false;
+            }
+            uint8_t fill[CHUNK_SIZE];
+            memset(fill, _fillByte, sizeof(fill));
+            _output.playData(fill, sizeof(fill));
+            _fillSent += sizeof(fill);
+            return true;
+        }
+
+        case State::IDLE:
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,169 @@
+#include "block_reader.h"
+
+BlockReader::BlockReader(StorageFile &file) : _file(file), _size(file.size()) {
+}
+
+// Load the block containing pos. Returns false at end of file.
+bool BlockReader::fill(const uint32_t pos) {
+    if (pos >= _size) return false;
+    if (_bufLen > 0 && pos >= _bufStart && pos < _bufStart + _bufLen) return true;
+
+    const uint32_t blockStart = pos & ~static_cast<uint32_t>(BLOCK_SIZE - 1);
+    _buf = sector_cache.read(_file, blockStart / BLOCK_SIZE, _bufLen);
+    if (!_buf) {
+        _bufLen = 0;
+        return false;
+    }
+    _bufStart = blockStart;
+    return pos < _bufStart + _bufLen;
+}
+
+bool BlockReader::seek(const uint32_t pos) {
+    if (pos > _size) {
+        _pos = _size;
+        return false;
+    }
+    _pos = pos;
+    return true;
+}
+
+int BlockReader::peek() {
+    if (!fill(_pos)) return -1;
+    return _buf[_pos - _bufStart];
+}
+
+int BlockReader::read() {
+    const int c = peek();
+    if (c >= 0) _pos++;
+    return c;
+}
+
+uint16_t BlockReader::read(void* dest, const uint16_t count) {
+    auto* out = static_cast<uint8_t*>(dest);
+    uint16_t total = 0;
+
+    while (total < count && fill(_pos)) {
+        const uint16_t offset = _pos - _bufStart;
+        const uint16_t chunk = min(static_cast<uint16_t>(_bufLen - offset), static_cast<uint16_t>(count - total));
+        memcpy(out + total, _buf + offset, chunk);
+        total += chunk;
+        _pos += chunk;
+    }
+    return total;
+}
+
+uint16_t BlockReader::read_u16le() {
+    uint8_t b[2] = {0};
+    read(b, 2);
+    return static_cast<uint16_t>(b[0] | (b[1] << 8));
+}
+
+uint32_t BlockReader::read_u24be() {
+    uint8_t b[3] = {0};
+    read(b, 3);
+    return (static_cast<uint32_t>(b[0]) << 16) | (static_cast<uint32_t>(b[1]) << 8) | b[2];
+}
+
+uint32_t BlockReader::read_u32be() {
+    uint8_t b[4] = {0};
+    read(b, 4);
+    return (static_cast<uint32_t>(b[0]) << 24) | (static_cast<uint32_t>(b[1]) << 16) |
+           (static_cast<uint32_t>(b[2]) << 8) | b[3];
+}
+
+uint32_t BlockReader::read_u32le() {
+    uint8_t b[4] = {0};
+    read(b, 4);
+    return (static_cast<uint32_t>(b[3]) << 24) | (static_cast<uint32_t>(b[2]) << 16) |
+           (static_cast<uint32_t>(b[1]) << 8) | b[0];
+}
+
+uint64_t BlockReader::read_u64le() {
+    uint8_t b[8] = {0};
+    read(b, 8);
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | b[i];
+    }
+    return value;
+}
+
+// Read a sync safe integer (used in ID3v2)
+uint32_t BlockReader::read_syncsafe() {
+    uint8_t b[4] = {0};
+    read(b, 4);
+    return (static_cast<uint32_t>(b[0] & 0x7F) << 21) | (static_cast<uint32_t>(b[1] & 0x7F) << 14) |
+           (static_cast<uint32_t>(b[2] & 0x7F) << 7) | (b[3] & 0x7F);
+}
+
+bool BlockReader::find(const void* pattern, const uint8_t length, const uint32_t limit) {
+    const auto* pat = static_cast<const uint8_t*>(pattern);
+    if (length == 0) return true;
+
+    const uint32_t end = (limit > _size - min(_pos, _size)) ? _size : _pos + limit;
+    while (_pos + length <= end && fill(_pos)) {
+        // Scan the buffered block for the first byte with memchr
+        const uint16_t offset = _pos - _bufStart;
+        const uint32_t blockEnd = min(_bufStart + _bufLen, end);
+        const auto* hit = static_cast<const uint8_t*>(memchr(_buf + offset, pat[0], blockEnd - _pos));
+        if (!hit) {
+            _pos = blockEnd;
+            continue;
+        }
+        _pos = _bufStart + (hit - _buf);
+        if (_pos + length > end) break;
+
+        // Compare the rest, which may straddle a block boundary
+        const uint32_t matchStart = _pos;
+        bool match = true;
+        for (uint8_t i = 1; i < length && match; i++) {
+            _pos = matchStart + i;
+            match = peek() == pat[i];
+        }
+        if (match) {
+            _pos = matchStart;
+            return true;
+        }
+        _pos = matchStart + 1;
+    }
+    _pos = end;
+    return false;
+}
+
+bool BlockReader::rfind(const void* pattern, const uint8_t length, const uint32_t limit) {
+    const auto* pat = static_cast<const uint8_t*>(pattern);
+    if (length == 0 || _pos == 0) return false;
+
+    const uint32_t origin = _pos;
+    const uint32_t lowest = limit < origin ? origin - limit : 0;
+    uint32_t pos = origin;
+
+    while (pos > lowest && fill(pos - 1)) {
+        // Walk the buffered block backwards looking for the first byte
+        const uint32_t blockLow = max(_bufStart, lowest);
+        uint32_t candidate = pos;
+        while (candidate > blockLow) {
+            candidate--;
+            if (_buf[candidate - _bufStart] == pat[0]) break;
+        }
+        if (_buf[candidate - _bufStart] != pat[0]) {
+            pos = blockLow;
+            continue;
+        }
+        pos = candidate;
+        if (candidate + length > _size) continue;
+
+        // Compare the rest, which may straddle into the next block
+        bool match = true;
+        for (uint8_t i = 1; i < length && match; i++) {
+            _pos = candidate + i;
+            match = peek() == pat[i];
+        }
+        if (match) {
+            _pos = candidate;
+            return true;
+        }
+    }
+    _pos = origin;
+    return false;
+}
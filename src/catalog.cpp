@@ -0,0 +1,229 @@
+#include "catalog.h"
+
+static constexpr uint32_t FNV_PRIME = 16777619u;
+
+static uint32_t fnv1a(uint32_t hash, const void* data, const size_t length) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+void DirFingerprint::add(const char* name, const uint32_t size, const bool isDirectory) {
+    entries++;
+    signature = fnv1a(signature, name, strlen(name));
+    signature = fnv1a(signature, &size, sizeof(size));
+    const uint8_t type = isDirectory ? 1 : 0;
+    signature = fnv1a(signature, &type, 1);
+}
+
+static constexpr uint32_t CHECKSUM_START = 2166136261u;
+
+// The checksum runs over the records and the order table as they are
+// written, then over the footer's fields up to the checksum itself
+static uint32_t footerChecksum(const uint32_t body, const CatalogFooter& footer) {
+    return fnv1a(body, &footer, offsetof(CatalogFooter, checksum));
+}
+
+// Checksum of the records and order table of an open catalog file
+static bool bodyChecksum(StorageFile& file, const uint32_t length, uint32_t& checksum) {
+    if (!file.seek(0)) return false;
+    checksum = CHECKSUM_START;
+    uint8_t chunk[256];
+    for (uint32_t done = 0; done < length;) {
+        const uint16_t n = static_cast<uint16_t>(min(length - done, static_cast<uint32_t>(sizeof(chunk))));
+        if (file.read(chunk, n) != n) return false;
+        checksum = fnv1a(checksum, chunk, n);
+        done += n;
+    }
+    return true;
+}
+
+static uint32_t catalogSize(const uint16_t count) {
+    return static_cast<uint32_t>(count) * (sizeof(CatalogRecord) + sizeof(uint16_t)) + sizeof(CatalogFooter);
+}
+
+void albumFromRecord(const CatalogRecord& record, Album& album) {
+    memcpy(album.path, record.path, ALBUM_PATH_LEN);
+    memcpy(album.title, record.title, ALBUM_TEXT_LEN);
+    memcpy(album.artist, record.artist, ALBUM_TEXT_LEN);
+    album.path[ALBUM_PATH_LEN - 1] = '\0';
+    album.title[ALBUM_TEXT_LEN - 1] = '\0';
+    album.artist[ALBUM_TEXT_LEN - 1] = '\0';
+    album.expected_song_count = record.expected_song_count;
+}
+
+// ============================================================================
+// READING
+// ============================================================================
+
+bool Catalog::openFile(const char* path, CatalogFooter& footer) {
+    _file = storage.open(path);
+    if (!_file) return false;
+
+    const uint32_t size = _file.size();
+    uint32_t body = 0;
+    if (size >= sizeof(CatalogFooter) &&
+        _file.seek(size - sizeof(CatalogFooter)) &&
+        _file.read(&footer, sizeof(footer)) == sizeof(footer) &&
+        footer.magic == CATALOG_MAGIC &&
+        footer.end_magic == CATALOG_END_MAGIC &&
+        footer.version == CATALOG_VERSION &&
+        footer.record_size == sizeof(CatalogRecord) &&
+        size == catalogSize(footer.album_count) &&
+        bodyChecksum(_file, size - sizeof(CatalogFooter), body) &&
+        footer.checksum == footerChecksum(body, footer)) {
+        return true;
+    }
+
+    Serial.print("Catalog invalid: ");
+    Serial.println(path);
+    _file.close();
+    return false;
+}
+
+bool Catalog::open() {
+    close();
+
+    CatalogFooter primary{};
+    CatalogFooter alternate{};
+    const bool hasPrimary = storage.exists(CATALOG_PATH) && openFile(CATALOG_PATH, primary);
+    if (hasPrimary) _file.close();
+    const bool hasAlternate = storage.exists(CATALOG_ALT_PATH) && openFile(CATALOG_ALT_PATH, alternate);
+    if (hasAlternate) _file.close();
+
+    if (!hasPrimary && !hasAlternate) {
+        Serial.println("No catalog found");
+        return false;
+    }
+
+    // Both valid means power was lost before the old one was removed
+    const bool useAlternate = hasAlternate && (!hasPrimary || alternate.generation > primary.generation);
+    const char* stale = useAlternate ? CATALOG_PATH : CATALOG_ALT_PATH;
+    if (hasPrimary && hasAlternate) {
+        storage.remove(stale);
+    }
+
+    _path = useAlternate ? CATALOG_ALT_PATH : CATALOG_PATH;
+    const CatalogFooter& footer = useAlternate ? alternate : primary;
+    _file = storage.open(_path);
+    if (!_file) return false;
+
+    _count = footer.album_count;
+    _flags = footer.flags;
+    _generation = footer.generation;
+    _open = true;
+
+    Serial.print("Opened catalog: ");
+    Serial.print(_count);
+    Serial.println(" albums");
+    return true;
+}
+
+void Catalog::close() {
+    _file.close();
+    _open = false;
+    _count = 0;
+}
+
+bool Catalog::readRecord(const uint16_t index, CatalogRecord& record) {
+    if (!_open || index >= _count) return false;
+    if (!_file.seek(static_cast<uint32_t>(index) * sizeof(CatalogRecord))) return false;
+    return _file.read(&record, sizeof(record)) == sizeof(record);
+}
+
+bool Catalog::readOrder(const uint16_t position, uint16_t* indices, const uint16_t count) {
+    if (!_open || position + count > _count) return false;
+    const uint32_t offset = static_cast<uint32_t>(_count) * sizeof(CatalogRecord) + position * sizeof(uint16_t);
+    if (!_file.seek(offset)) return false;
+    if (_file.read(indices, count * sizeof(uint16_t)) != static_cast<int>(count * sizeof(uint16_t))) return false;
+    for (uint16_t i = 0; i < count; i++) {
+        if (indices[i] >= _count) return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// WRITING
+// ============================================================================
+
+bool CatalogWriter::begin(const char* path, const uint32_t generation) {
+    // FILE_WRITE appends, so start from an empty file
+    if (storage.exists(path)) {
+        storage.remove(path);
+    }
+    _file = storage.open(path, StorageMode::WRITE);
+    _path = path;
+    _generation = generation;
+    _count = 0;
+    _checksum = CHECKSUM_START;
+    _ok = static_cast<bool>(_file);
+    if (!_ok) {
+        Serial.println("Failed to create catalog!");
+    }
+    return _ok;
+}
+
+bool CatalogWriter::append(const CatalogRecord& record) {
+    if (!_ok) return false;
+    _ok = _file.write(reinterpret_cast<const uint8_t*>(&record), sizeof(record)) == sizeof(record);
+    if (_ok) {
+        _checksum = fnv1a(_checksum, &record, sizeof(record));
+        _count++;
+    }
+    return _ok;
+}
+
+void CatalogWriter::flush() {
+    if (_ok) {
+        _file.flush();
+    }
+}
+
+bool CatalogWriter::finish(const uint16_t* order, const bool sorted) {
+    // Order table, written a chunk at a time
+    uint16_t chunk[64];
+    for (uint16_t i = 0; i < _count && _ok; i += 64) {
+        const uint16_t n = min(static_cast<uint16_t>(_count - i), static_cast<uint16_t>(64));
+        for (uint16_t j = 0; j < n; j++) {
+            chunk[j] = order ? order[i + j] : i + j;
+        }
+        _ok = _file.write(reinterpret_cast<const uint8_t*>(chunk), n * sizeof(uint16_t)) == n * sizeof(uint16_t);
+        _checksum = fnv1a(_checksum, chunk, n * sizeof(uint16_t));
+    }
+
+    if (_ok) {
+        CatalogFooter footer{};
+        footer.magic = CATALOG_MAGIC;
+        footer.version = CATALOG_VERSION;
+        footer.record_size = sizeof(CatalogRecord);
+        footer.album_count = _count;
+        footer.flags = sorted ? CATALOG_FLAG_SORTED : 0;
+        footer.generation = _generation;
+        footer.checksum = footerChecksum(_checksum, footer);
+        footer.end_magic = CATALOG_END_MAGIC;
+        _ok = _file.write(reinterpret_cast<const uint8_t*>(&footer), sizeof(footer)) == sizeof(footer);
+    }
+
+    if (!_ok) {
+        Serial.println("Failed to write catalog!");
+        abort();
+        return false;
+    }
+
+    _file.close();
+    Serial.print("Saved catalog: ");
+    Serial.print(_count);
+    Serial.println(" albums");
+    return true;
+}
+
+void CatalogWriter::abort() {
+    _file.close();
+    if (_path) {
+        storage.remove(_path);
+    }
+    _ok = false;
+}
@@ -0,0 +1,75 @@
+#include "collation.h"
+#include "lcd_charset.h"
+
+// Longest digit run encoded as a single number. Longer runs continue as a
+// second number, which only matters for names with 10+ digit numbers.
+static constexpr uint8_t MAX_DIGITS = 9;
+
+static bool isDigit(const char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Accented letters (display codes, see lcd_charset.h) fold to their base letter
+static char foldCase(char c) {
+    if (static_cast<uint8_t>(c) >= 0x80) c = lcdBaseChar(c);
+    return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+CollationCursor::CollationCursor(const char* text) : _text(text) {
+    // Skip a leading "The ", unless that is the whole name
+    static const char article[] = "the ";
+    uint8_t i = 0;
+    while (i < 4 && foldCase(text[i]) == article[i]) i++;
+    if (i == 4 && text[4] != '\0') {
+        _text = text + 4;
+    }
+}
+
+int CollationCursor::next() {
+    if (_pendingDigits > 0) {
+        _pendingDigits--;
+        return static_cast<uint8_t>(*_text++);
+    }
+
+    const char c = *_text;
+    if (c == '\0') return -1;
+
+    if (isDigit(c)) {
+        // Longer numbers sort after shorter ones, equal lengths digit by digit
+        while (*_text == '0' && isDigit(_text[1])) _text++;
+        uint8_t length = 0;
+        while (length < MAX_DIGITS && isDigit(_text[length])) length++;
+        _pendingDigits = length;
+        return '0' + length;
+    }
+
+    _text++;
+    return static_cast<uint8_t>(foldCase(c));
+}
+
+int compareKeys(const char* a, const char* b) {
+    CollationCursor keyA(a);
+    CollationCursor keyB(b);
+    while (true) {
+        const int byteA = keyA.next();
+        const int byteB = keyB.next();
+        if (byteA != byteB) return byteA - byteB;
+        if (byteA < 0) return 0;
+    }
+}
+
+int collate(const char* a, const char* b) {
+    const int cmp = compareKeys(a, b);
+    return cmp != 0 ? cmp : strcmp(a, b);
+}
+
+uint8_t collationKey(const char* text, uint8_t* key, const uint8_t size) {
+    CollationCursor cursor(text);
+    uint8_t length = 0;
+    int byte;
+    while (length < size && (byte = cursor.next()) >= 0) {
+        key[length++] = byte;
+    }
+    memset(key + length, 0, size - length);
+    return length;
+}
@@ -0,0 +1,88 @@
+#include "dir_listing.h"
+#include <media.h>
+#include <stdlib.h>
+
+DirStats dir_stats;
+
+// Initial room for names, grown like the entries
+static constexpr uint16_t NAME_ESTIMATE = 16;
+
+StorageFile openDirectory(const char* path) {
+    dir_stats.opens++;
+    return storage.open(path);
+}
+
+void rewindEntries(StorageFile& dir) {
+    dir_stats.passes++;
+    dir.rewindDirectory();
+}
+
+bool openNextEntry(StorageFile& dir, StorageFile& entry) {
+    dir_stats.entries++;
+    return entry.openNext(dir);
+}
+
+DirListing::~DirListing() {
+    clear();
+}
+
+void DirListing::clear() {
+    _firstAudio.close();
+    free(_entries);
+    _entries = nullptr;
+    _count = 0;
+    _capacity = 0;
+    _audioCount = 0;
+    _hasSubdirs = false;
+    _names.release();
+}
+
+bool DirListing::append(StorageFile& entry) {
+    if (_count >= _capacity) {
+        const uint16_t capacity = _capacity + GROW_STEP;
+        auto* entries = static_cast<DirEntry*>(realloc(_entries, capacity * sizeof(DirEntry)));
+        if (!entries) return false;
+        _entries = entries;
+        _capacity = capacity;
+    }
+
+    DirEntry& item = _entries[_count];
+    char name[STORAGE_NAME_LEN];
+    if (!entry.getName(name, sizeof(name))) return true; // name too long, skipped
+    item.name = _names.add(name);
+    if (item.name == 0) return false;
+    item.isDirectory = entry.isDirectory();
+    item.isAudio = !item.isDirectory && isAudioFile(name);
+    item.size = item.isDirectory ? 0 : entry.size();
+    item.modified = item.isDirectory ? entry.modified() : 0;
+    _count++;
+
+    if (item.isDirectory) {
+        _hasSubdirs = true;
+    } else if (item.isAudio) {
+        _audioCount++;
+    }
+    return true;
+}
+
+bool DirListing::read(StorageFile& dir, const bool keepFirstAudio) {
+    clear();
+    if (!_names.reserve(GROW_STEP * NAME_ESTIMATE)) return false;
+
+    rewindEntries(dir);
+    bool ok = true;
+    StorageFile entry;
+    while (openNextEntry(dir, entry)) {
+        const uint16_t count = _count;
+        ok = append(entry);
+        if (ok && keepFirstAudio && !_firstAudio && _count > count && _entries[count].isAudio) {
+            _firstAudio.take(entry);
+        }
+        if (!ok) {
+            Serial.println("Out of memory listing directory!");
+            break;
+        }
+    }
+    entry.close();
+    return ok;
+}
@@ -1,4 +1,44 @@
 #include <lcd.h>
+#include <lcd_charset.h>
+#include <Wire.h>
+
+// The backpack is an MCP23008 whose GPIO port drives the HD44780 in 4-bit
+// mode. The library sets and strobes each pin with a read-modify-write of the
+// port, a dozen or so I2C transactions per character. The batched driver
+// instead writes the port directly, with the MCP23008's address pointer held
+// on GPIO (IOCON.SEQOP), so one transaction can carry any number of port
+// values: every nibble as E high then E low. The HD44780 latches a nibble on
+// each falling edge; those are two bytes (180 us at 100 kHz, 45 us at
+// 400 kHz) apart, longer than the 37 us a command or character takes.
+namespace {
+constexpr uint8_t MCP23008_BASE = 0x20;
+constexpr uint8_t MCP23008_IOCON = 0x05;
+constexpr uint8_t MCP23008_GPIO = 0x09;
+constexpr uint8_t IOCON_SEQOP = 0x20;
+
+// Backpack wiring; D4-D7 are GP3-GP6
+constexpr uint8_t PIN_RS = 1 << 1;
+constexpr uint8_t PIN_EN = 1 << 2;
+constexpr uint8_t DATA_SHIFT = 3;
+constexpr uint8_t PIN_LITE = 1 << 7;
+
+constexpr uint8_t HD44780_SETCGRAMADDR = 0x40;
+constexpr uint8_t HD44780_SETDDRAMADDR = 0x80;
+constexpr uint8_t ROW_OFFSETS[] = {0x00, 0x40, 0x14, 0x54};
+
+// Bytes per transaction, register address included; the SAMD and RP2040
+// Wire buffers hold 256
+constexpr uint8_t I2C_BURST = 128;
+// Unchanged cells between two changed ones are rewritten rather than
+// starting a new run, up to this many: a run costs a transaction and a
+// cursor move, about as much as two characters
+constexpr uint8_t RUN_GAP = 2;
+
+// CGRAM slots for accented letters. Each is drawn with the code's alias
+// 0x08 + slot, as slot 0's own code would end a string.
+constexpr uint8_t GLYPH_SLOT_NUMBERS[Lcd::GLYPH_SLOTS] = {0, 3, 4, 5, 6, 7};
+constexpr uint8_t GLYPH_ALIAS = 0x08;
+}
 
 uint8_t up_arrow[] = {
     0b00100, 0b01110, 0b11111, 0b00100, 0b00100, 0b00100, 0b00000, 0b00000
@@ -9,7 +49,7 @@ uint8_t down_arrow[] = {
 };
 
 
-Lcd::Lcd(const uint8_t i2cAddr) : _lcd(i2cAddr), _buffer{}
+Lcd::Lcd(const uint8_t i2cAddr) : _lcd(i2cAddr), _address(MCP23008_BASE | (i2cAddr & 0x07)), _buffer{}
 {
 }
 
@@ -20,17 +60,32 @@ bool Lcd::begin() {
     _lcd.createChar(CHAR_UP, up_arrow);
     _lcd.createChar(CHAR_DOWN, down_arrow);
 
+    // The library only ever writes one register per transaction, so it is
+    // unaffected
+    Wire.beginTransmission(_address);
+    Wire.write(MCP23008_IOCON);
+    Wire.write(IOCON_SEQOP);
+    if (Wire.endTransmission() != 0) {
+        return false;
+    }
+
     // Initialize the buffer
     for (auto & i : _buffer) {
         for (char & j : i) {
             j = ' ';
         }
     }
+    memcpy(_wanted, _buffer, sizeof(_wanted));
+    for (GlyphSlot& slot : _glyphs) {
+        slot = GlyphSlot();
+    }
+    _glyphRetry = 0;
 
     return true;
 }
 
 void Lcd::set_backlight(const bool on) {
+    _backlight = on;
     _lcd.setBacklight(on ? 1 : 0);
 }
 
@@ -40,6 +95,10 @@ void Lcd::clear_buffer() {
             j = ' ';
         }
     }
+    memcpy(_wanted, _buffer, sizeof(_wanted));
+    _glyphRetry = 0;
+    _drawn.screen = Drawn::Screen::NONE;
+    stop_scrolling();
 }
 
 void Lcd::clear() {
@@ -47,114 +106,363 @@ void Lcd::clear() {
     _lcd.clear();
 }
 
-void Lcd::display_line(const String& text, const uint8_t line, const bool center) {
+void Lcd::display_line(const char* text, const uint8_t line, const bool center) {
+    _drawn.screen = Drawn::Screen::NONE;
+    draw_line(text, line, center);
+}
+
+void Lcd::draw_line(const char* text, const uint8_t line, const bool center) {
     if (line >= ROWS) return;
-    String displayText = text;
-    uint8_t length = displayText.length();
+    Marquee& marquee = _marquee[line];
+    const size_t full = strnlen(text, MARQUEE_LEN);
+    if (full > COLS) {
+        // Carry on scrolling if it is the same text
+        if (marquee.length == full && memcmp(marquee.text, text, full) == 0) return;
+        // The first line to scroll starts the clock; others keep step with it
+        if (!scrolling()) _marqueeNext = millis() + MARQUEE_STEP_MS;
+        memcpy(marquee.text, text, full);
+        marquee.length = full;
+        marquee.offset = 0;
+        marquee.direction = 1;
+        marquee.hold = MARQUEE_PAUSE_STEPS;
+        update_row(line, marquee.text);
+        return;
+    }
+    marquee.length = 0;
+
+    // Padded with spaces
+    const uint8_t length = full;
+    const uint8_t start = center ? (COLS - length) / 2 : 0;
+    char row[COLS];
+    memset(row, ' ', COLS);
+    memcpy(row + start, text, length);
+    update_row(line, row);
+}
 
-    // Truncate if too long
-    if (length > COLS) {
-        displayText = displayText.substring(0, COLS);
-        length = COLS;
+void Lcd::display_character(const char c, const uint8_t line, const uint8_t col) {
+    _drawn.screen = Drawn::Screen::NONE;
+    if (col >= COLS || line >= ROWS) return;
+    _marquee[line].length = 0;
+    if (c != _wanted[line][col]) {
+        char row[COLS];
+        memcpy(row, _wanted[line], COLS);
+        row[col] = c;
+        update_row(line, row);
     }
-    uint8_t start = 0;
-    if (center) {
-        start = (COLS - length) / 2;
+}
+
+bool Lcd::scrolling() const {
+    for (const Marquee& marquee : _marquee) {
+        if (marquee.length) return true;
     }
-    for (uint8_t i=0; i<start; i++) {
-        displayText = " " + displayText;
+    return false;
+}
+
+bool Lcd::scroll_due(const uint32_t now) const {
+    return scrolling() && static_cast<int32_t>(now - _marqueeNext) >= 0;
+}
+
+void Lcd::scroll(const uint32_t now) {
+    if (!scroll_due(now)) return;
+    _marqueeNext = now + MARQUEE_STEP_MS;
+    for (uint8_t line = 0; line < ROWS; line++) {
+        Marquee& marquee = _marquee[line];
+        if (!marquee.length) continue;
+        if (marquee.hold) {
+            marquee.hold--;
+            continue;
+        }
+        marquee.offset += marquee.direction;
+        if (marquee.offset == 0 || marquee.offset == marquee.length - COLS) {
+            marquee.direction = -marquee.direction;
+            marquee.hold = MARQUEE_PAUSE_STEPS;
+        }
+        update_row(line, marquee.text + marquee.offset);
+    }
+}
+
+void Lcd::stop_scrolling() {
+    for (Marquee& marquee : _marquee) {
+        marquee.length = 0;
     }
-    for (uint8_t i=start+length; i<COLS; i++) {
-        displayText += " ";
+}
+
+void Lcd::update_row(const uint8_t line, const char* text) {
+    // text is _wanted[line] itself when retried
+    memmove(_wanted[line], text, COLS);
+    text = _wanted[line];
+
+    // Glyphs by their slot. Those already loaded are claimed before any slot
+    // is taken for the others.
+    _glyphClock++;
+    for (uint8_t col = 0; col < COLS; col++) {
+        if (!isLcdGlyph(text[col])) continue;
+        for (GlyphSlot& slot : _glyphs) {
+            if (slot.glyph == text[col]) slot.used = _glyphClock;
+        }
     }
-    for (uint8_t i=0; i<COLS; i++) {
-        if (displayText[i] != _buffer[line][i]) {
-            _lcd.setCursor(i, line);
-            _lcd.write(displayText[i]);
-            _buffer[line][i] = displayText[i];
+    char row[COLS];
+    bool missing = false;
+    for (uint8_t col = 0; col < COLS; col++) {
+        char c = text[col];
+        if (isLcdGlyph(c)) {
+            const char code = glyph_code(c, line);
+            missing |= code == 0;
+            c = code ? code : lcdBaseChar(c);
         }
+        row[col] = c;
+    }
+
+    uint8_t col = 0;
+    while (col < COLS) {
+        if (row[col] == _buffer[line][col]) {
+            col++;
+            continue;
+        }
+        // Extend the run to the last changed cell before a long enough gap
+        uint8_t last = col;
+        for (uint8_t i = col + 1; i < COLS && i - last <= RUN_GAP + 1; i++) {
+            if (row[i] != _buffer[line][i]) last = i;
+        }
+        const uint8_t length = last - col + 1;
+        write_run(line, col, row + col, length);
+        memcpy(&_buffer[line][col], row + col, length);
+        col = last + 1;
+    }
+
+    // This row may have let go of slots that others went without
+    const uint8_t bit = 1 << line;
+    _glyphRetry = missing ? _glyphRetry | bit : _glyphRetry & ~bit;
+    if ((_glyphRetry & ~bit) && !_retrying) {
+        _retrying = true;
+        for (uint8_t other = 0; other < ROWS; other++) {
+            if (other != line && (_glyphRetry & (1 << other))) update_row(other, _wanted[other]);
+        }
+        _retrying = false;
     }
 }
 
-void Lcd::display_character(const char c, const uint8_t line, const uint8_t col) {
-    if (col >= COLS || line >= ROWS) return;
-    if (c != _buffer[line][col]) {
-        _lcd.setCursor(col, line);
-        _lcd.write(c);
-        _buffer[line][col] = c;
+char Lcd::glyph_code(const char glyph, const uint8_t line) {
+    // Least recently used of the slots neither claimed by this row nor shown
+    // on another
+    uint8_t victim = GLYPH_SLOTS;
+    for (uint8_t i = 0; i < GLYPH_SLOTS; i++) {
+        const GlyphSlot& slot = _glyphs[i];
+        const char code = static_cast<char>(GLYPH_ALIAS + GLYPH_SLOT_NUMBERS[i]);
+        if (slot.glyph == glyph) return code;
+        if (slot.used == _glyphClock) continue;
+        bool shown = false;
+        for (uint8_t row = 0; row < ROWS && !shown; row++) {
+            shown = row != line && memchr(_buffer[row], code, COLS) != nullptr;
+        }
+        if (!shown && (victim == GLYPH_SLOTS || slot.used < _glyphs[victim].used)) victim = i;
     }
+    if (victim == GLYPH_SLOTS) return 0;
+
+    _glyphs[victim].glyph = glyph;
+    _glyphs[victim].used = _glyphClock;
+    load_glyph(GLYPH_SLOT_NUMBERS[victim], glyph);
+    return static_cast<char>(GLYPH_ALIAS + GLYPH_SLOT_NUMBERS[victim]);
 }
 
-void Lcd::display_progress(const uint32_t elapsed, const uint32_t duration, uint8_t index, uint8_t total, uint8_t line) {
-    String time = "";
+void Lcd::load_glyph(const uint8_t slot, const char glyph) {
+    stats.glyphs++;
+    const uint8_t* rows = lcdGlyphRows(glyph);
+    if (!_batched) {
+        const uint32_t start = micros();
+        uint8_t charmap[8];
+        memcpy(charmap, rows, sizeof(charmap));
+        _lcd.createChar(slot, charmap);
+        stats.busUs += micros() - start;
+        return;
+    }
+
+    // The address command and all 8 rows in one transaction
+    begin_transaction();
+    send(HD44780_SETCGRAMADDR | (slot << 3), false);
+    for (uint8_t i = 0; i < 8; i++) {
+        send(rows[i], true);
+    }
+    end_transaction();
+}
+
+void Lcd::write_run(const uint8_t line, const uint8_t col, const char* text, const uint8_t length) {
+    stats.cells += length;
+    if (!_batched) {
+        const uint32_t start = micros();
+        for (uint8_t i = 0; i < length; i++) {
+            _lcd.setCursor(col + i, line);
+            _lcd.write(text[i]);
+        }
+        stats.busUs += micros() - start;
+        return;
+    }
+
+    begin_transaction();
+    send(HD44780_SETDDRAMADDR | (ROW_OFFSETS[line] + col), false);
+    for (uint8_t i = 0; i < length; i++) {
+        send(text[i], true);
+    }
+    end_transaction();
+}
+
+void Lcd::begin_transaction() {
+    Wire.beginTransmission(_address);
+    Wire.write(MCP23008_GPIO);
+    _burst = 1;
+    // The library may have written the port since
+    _control = 0xFF;
+}
 
-    // Format: "MM:SS / MM:SS"
-    const uint8_t elapsedMin = elapsed / 60;
-    const uint8_t elapsedSec = elapsed % 60;
-    const uint8_t durationMin = duration / 60;
-    const uint8_t durationSec = duration % 60;
+void Lcd::end_transaction() {
+    // Wire only buffers until now
+    const uint32_t start = micros();
+    if (Wire.endTransmission() != 0) stats.errors++;
+    stats.busUs += micros() - start;
+    stats.transactions++;
+    stats.bytes += _burst - 1;
+}
 
-    if (elapsedMin < 10) time += "0";
-    time += String(elapsedMin) + ":";
-    if (elapsedSec < 10) time += "0";
-    time += String(elapsedSec) + "/";
-    if (durationMin < 10) time += "0";
-    time += String(durationMin) + ":";
-    if (durationSec < 10) time += "0";
-    time += String(durationSec);
+void Lcd::send(const uint8_t value, const bool data) {
+    // Up to one byte setting RS, then two per nibble
+    if (_burst + 5 > I2C_BURST) {
+        end_transaction();
+        begin_transaction();
+    }
 
-    const String album_progress = "(" + String(index) + "/" + String(total) + ")";
-    String text = time;
-    for (uint8_t i=0; i<COLS-album_progress.length()-time.length(); i++) {
-        text += ' ';
+    const uint8_t control = (_backlight ? PIN_LITE : 0) | (data ? PIN_RS : 0);
+    if (control != _control) {
+        // RS settles with E low before the first strobe
+        Wire.write(control);
+        _burst++;
+        _control = control;
     }
-    text += album_progress;
-    
-    display_line(text, line, false);
+    const uint8_t high = control | ((value >> 4) << DATA_SHIFT);
+    const uint8_t low = control | ((value & 0x0F) << DATA_SHIFT);
+    Wire.write(high | PIN_EN);
+    Wire.write(high);
+    Wire.write(low | PIN_EN);
+    Wire.write(low);
+    _burst += 4;
+}
+
+// Decimal digits of value, zero padded to at least minDigits; returns how
+// many were written
+static uint8_t format_number(char* out, uint32_t value, const uint8_t minDigits) {
+    char digits[10];
+    uint8_t count = 0;
+    do {
+        digits[count++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value);
+    while (count < minDigits) {
+        digits[count++] = '0';
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        out[i] = digits[count - 1 - i];
+    }
+    return count;
+}
+
+void Lcd::display_progress(const uint32_t elapsed, const uint32_t duration, uint8_t index, uint8_t total, uint8_t line) {
+    // "MM:SS/MM:SS" on the left
+    char time[24];
+    uint8_t timeLength = format_number(time, elapsed / 60, 2);
+    time[timeLength++] = ':';
+    timeLength += format_number(time + timeLength, elapsed % 60, 2);
+    time[timeLength++] = '/';
+    timeLength += format_number(time + timeLength, duration / 60, 2);
+    time[timeLength++] = ':';
+    timeLength += format_number(time + timeLength, duration % 60, 2);
+
+    // "(index/total)" on the right, unless the time is in the way
+    char count[12];
+    uint8_t countLength = 0;
+    count[countLength++] = '(';
+    countLength += format_number(count + countLength, index, 1);
+    count[countLength++] = '/';
+    countLength += format_number(count + countLength, total, 1);
+    count[countLength++] = ')';
+
+    char row[COLS];
+    memset(row, ' ', COLS);
+    _marquee[line].length = 0;
+    if (timeLength > COLS) timeLength = COLS;
+    memcpy(row, time, timeLength);
+    const uint8_t countStart = timeLength + countLength <= COLS ? COLS - countLength : timeLength;
+    memcpy(row + countStart, count, min(countLength, static_cast<uint8_t>(COLS - countStart)));
+    update_row(line, row);
 }
 
 void Lcd::display_playing(const Song* song, const Album* album, const uint32_t elapsed) {
     if (!song) return;
+    if (_drawn.screen == Drawn::Screen::PLAYING && _drawn.item == song && _drawn.albumIndex == album->index &&
+        _drawn.count == album->song_count && _drawn.position == elapsed) {
+        return;
+    }
+    _drawn.screen = Drawn::Screen::PLAYING;
+    _drawn.item = song;
+    _drawn.albumIndex = album->index;
+    _drawn.count = album->song_count;
+    _drawn.position = elapsed;
+
     uint8_t n_songs = album->song_count;
-    if (n_songs == 1 && album->title == song->album) {
+    if (n_songs == 1 && strcmp(album->text(song->album), album->title) == 0) {
         // If there is only one song, and it is titled the same as the album, only show the name once
         // This is mainly for classical pieces
-        display_line(" ", 0);
+        draw_line("", 0);
     } else {
-        display_line(song->title, 0);
+        draw_line(album->text(song->title), 0);
     }
-    display_line(song->album, 1);
-    display_line(song->artist, 2);
+    draw_line(album->text(song->album), 1);
+    draw_line(album->text(song->artist), 2);
     display_progress(elapsed, song->duration, song->trackNumber, n_songs, 3);
 }
 
-void Lcd::display_album_list(const Album* albums, const uint16_t albumCount, const uint16_t selectedIndex) {
-    if (albumCount > 0 && albums != nullptr) {
-        const Album* selected = &albums[selectedIndex];
-        if (selectedIndex > 0) {
-            display_line(String(static_cast<char>(CHAR_UP)), 0, false);
-        } else {
-            display_line("", 0, false);
-        }
-        display_line(selected->artist, 1);
-        display_line(selected->title, 2);
+void Lcd::display_album_list(const Album* selected, const uint16_t albumCount, const uint16_t selectedIndex) {
+    if (_drawn.screen == Drawn::Screen::ALBUM_LIST && _drawn.item == selected &&
+        _drawn.albumIndex == (selected ? selected->index : 0) && _drawn.count == albumCount &&
+        _drawn.position == selectedIndex) {
+        return;
+    }
+    _drawn.screen = Drawn::Screen::ALBUM_LIST;
+    _drawn.item = selected;
+    _drawn.albumIndex = selected ? selected->index : 0;
+    _drawn.count = albumCount;
+    _drawn.position = selectedIndex;
+
+    if (albumCount > 0 && selected != nullptr) {
+        const char up[] = {CHAR_UP, '\0'};
+        draw_line(selectedIndex > 0 ? up : "", 0, false);
+        draw_line(selected->artist, 1);
+        draw_line(selected->title, 2);
+
+        // "(n/count)", after a down arrow if there are more below
+        char text[COLS + 1];
+        uint8_t length = 0;
         if (selectedIndex < albumCount - 1) {
-            display_line(String(static_cast<char>(CHAR_DOWN)) + " (" + String(selectedIndex + 1) + "/" + String(albumCount) + ")", 3, false);
-        } else {
-            display_line("(" + String(selectedIndex + 1) + "/" + String(albumCount) + ")", 3, false);
+            text[length++] = CHAR_DOWN;
+            text[length++] = ' ';
         }
+        text[length++] = '(';
+        length += format_number(text + length, selectedIndex + 1, 1);
+        text[length++] = '/';
+        length += format_number(text + length, albumCount, 1);
+        text[length++] = ')';
+        text[length] = '\0';
+        draw_line(text, 3, false);
     } else {
-        display_line("No albums found!", 1);
-        display_line("Check the SD Card.", 2);
+        draw_line("No albums found!", 1);
+        draw_line("Check the SD Card.", 2);
     }
 }
 
-void Lcd::display_splash(const String& title, const String& subtitle) {
+void Lcd::display_splash(const char* title, const char* subtitle) {
     display_line(title, 1);
     display_line(subtitle, 2);
 }
 
-void Lcd::display_error(const String& message) {
+void Lcd::display_error(const char* message) {
     display_line("ERROR", 1);
     display_line(message, 2);
 }
@@ -0,0 +1,265 @@
+#include "lcd_charset.h"
+
+namespace {
+
+// Characters of the A00 ROM beyond ASCII, and the letter each stands for
+struct RomChar {
+    uint16_t codepoint;
+    uint8_t code;
+    char base;
+};
+
+constexpr RomChar ROM_CHARS[] = {
+    {0x00A2, 0xEC, 'c'},  // cent
+    {0x00A5, 0x5C, 'Y'},  // yen, where ASCII has '\'
+    {0x00B0, 0xDF, 'o'},  // degree
+    {0x00B5, 0xE4, 'u'},  // micro
+    {0x00B7, 0xA5, '.'},  // middle dot
+    {0x00DF, 0xE2, 's'},  // sharp s, as the ROM's beta
+    {0x00E4, 0xE1, 'a'},
+    {0x00F1, 0xEE, 'n'},
+    {0x00F6, 0xEF, 'o'},
+    {0x00F7, 0xFD, '/'},
+    {0x00FC, 0xF5, 'u'},
+    {0x03A3, 0xF6, 'S'},
+    {0x03A9, 0xF4, 'O'},
+    {0x03B1, 0xE0, 'a'},
+    {0x03B2, 0xE2, 'b'},
+    {0x03B5, 0xE3, 'e'},
+    {0x03B8, 0xF2, 't'},
+    {0x03BC, 0xE4, 'u'},
+    {0x03C0, 0xF7, 'p'},
+    {0x03C1, 0xE6, 'r'},
+    {0x03C3, 0xE5, 's'},
+    {0x2022, 0xA5, '.'},  // bullet
+    {0x2190, 0x7F, '<'},
+    {0x2192, 0x7E, '>'},
+    {0x221E, 0xF3, '8'},
+};
+constexpr uint8_t ROM_CHAR_COUNT = sizeof(ROM_CHARS) / sizeof(ROM_CHARS[0]);
+
+// Custom glyphs, codes LCD_GLYPH_FIRST on, drawn in the style of the ROM's
+// own letters
+struct Glyph {
+    uint16_t codepoint;
+    uint8_t rows[8];
+};
+
+constexpr Glyph GLYPHS[LCD_GLYPH_COUNT] = {
+    {0x00E9, {0b00010, 0b00100, 0b01110, 0b10001, 0b11111, 0b10000, 0b01110, 0b00000}},  // e acute
+    {0x00E8, {0b01000, 0b00100, 0b01110, 0b10001, 0b11111, 0b10000, 0b01110, 0b00000}},  // e grave
+    {0x00EA, {0b00100, 0b01010, 0b01110, 0b10001, 0b11111, 0b10000, 0b01110, 0b00000}},  // e circumflex
+    {0x00EB, {0b01010, 0b00000, 0b01110, 0b10001, 0b11111, 0b10000, 0b01110, 0b00000}},  // e diaeresis
+    {0x00E0, {0b01000, 0b00100, 0b01110, 0b00001, 0b01111, 0b10001, 0b01111, 0b00000}},  // a grave
+    {0x00E1, {0b00010, 0b00100, 0b01110, 0b00001, 0b01111, 0b10001, 0b01111, 0b00000}},  // a acute
+    {0x00E2, {0b00100, 0b01010, 0b01110, 0b00001, 0b01111, 0b10001, 0b01111, 0b00000}},  // a circumflex
+    {0x00E3, {0b01101, 0b10010, 0b01110, 0b00001, 0b01111, 0b10001, 0b01111, 0b00000}},  // a tilde
+    {0x00E5, {0b01110, 0b01010, 0b01110, 0b00001, 0b01111, 0b10001, 0b01111, 0b00000}},  // a ring
+    {0x00E7, {0b00000, 0b01110, 0b10000, 0b10000, 0b10001, 0b01110, 0b00100, 0b01000}},  // c cedilla
+    {0x00EC, {0b01000, 0b00100, 0b01100, 0b00100, 0b00100, 0b00100, 0b01110, 0b00000}},  // i grave
+    {0x00ED, {0b00010, 0b00100, 0b01100, 0b00100, 0b00100, 0b00100, 0b01110, 0b00000}},  // i acute
+    {0x00EE, {0b00100, 0b01010, 0b00000, 0b01100, 0b00100, 0b00100, 0b01110, 0b00000}},  // i circumflex
+    {0x00EF, {0b01010, 0b00000, 0b01100, 0b00100, 0b00100, 0b00100, 0b01110, 0b00000}},  // i diaeresis
+    {0x00F2, {0b01000, 0b00100, 0b01110, 0b10001, 0b10001, 0b10001, 0b01110, 0b00000}},  // o grave
+    {0x00F3, {0b00010, 0b00100, 0b01110, 0b10001, 0b10001, 0b10001, 0b01110, 0b00000}},  // o acute
+    {0x00F4, {0b00100, 0b01010, 0b01110, 0b10001, 0b10001, 0b10001, 0b01110, 0b00000}},  // o circumflex
+    {0x00F5, {0b01101, 0b10010, 0b01110, 0b10001, 0b10001, 0b10001, 0b01110, 0b00000}},  // o tilde
+    {0x00F8, {0b00000, 0b00001, 0b01110, 0b10011, 0b10101, 0b11001, 0b01110, 0b10000}},  // o stroke
+    {0x00F9, {0b01000, 0b00100, 0b10001, 0b10001, 0b10001, 0b10011, 0b01101, 0b00000}},  // u grave
+    {0x00FA, {0b00010, 0b00100, 0b10001, 0b10001, 0b10001, 0b10011, 0b01101, 0b00000}},  // u acute
+    {0x00FB, {0b00100, 0b01010, 0b10001, 0b10001, 0b10001, 0b10011, 0b01101, 0b00000}},  // u circumflex
+    {0x00E6, {0b00000, 0b00000, 0b11010, 0b00101, 0b01111, 0b10100, 0b01011, 0b00000}},  // ae
+    {0x00C4, {0b01010, 0b00000, 0b01110, 0b10001, 0b11111, 0b10001, 0b10001, 0b00000}},  // A diaeresis
+    {0x00D6, {0b01010, 0b00000, 0b01110, 0b10001, 0b10001, 0b10001, 0b01110, 0b00000}},  // O diaeresis
+    {0x00DC, {0b01010, 0b00000, 0b10001, 0b10001, 0b10001, 0b10001, 0b01110, 0b00000}},  // U diaeresis
+    {0x00C9, {0b00010, 0b00100, 0b11111, 0b10000, 0b11110, 0b10000, 0b11111, 0b00000}},  // E acute
+    {0x00C8, {0b01000, 0b00100, 0b11111, 0b10000, 0b11110, 0b10000, 0b11111, 0b00000}},  // E grave
+    {0x00C5, {0b00100, 0b01010, 0b00100, 0b01010, 0b10001, 0b11111, 0b10001, 0b00000}},  // A ring
+    {0x00D8, {0b01110, 0b10011, 0b10101, 0b10101, 0b10101, 0b11001, 0b01110, 0b00000}},  // O stroke
+    {0x00D1, {0b01101, 0b10010, 0b10001, 0b11001, 0b10101, 0b10011, 0b10001, 0b00000}},  // N tilde
+    {0x00C7, {0b01110, 0b10001, 0b10000, 0b10000, 0b10001, 0b01110, 0b00100, 0b01000}},  // C cedilla
+};
+
+// The unaccented stand-in for each of U+00A0-U+017F (Latin-1 Supplement and
+// Latin Extended-A)
+constexpr char LATIN_BASE[] =
+    " !cLoY|S\"ca<--r-" "o+23'uP.,1o>423?" "AAAAAAACEEEEIIII" "DNOOOOOxOUUUUYPs"
+    "aaaaaaaceeeeiiii" "dnooooo/ouuuuypy" "AaAaAaCcCcCcCcDd" "DdEeEeEeEeEeGgGg"
+    "GgGgHhHhIiIiIiIi" "IiIiJjKkkLlLlLlL" "lLlNnNnNnnNnOoOo" "OoOoRrRrRrSsSsSs"
+    "SsTtTtTtUuUuUuUu" "UuUuWwYyYZzZzZzs";
+constexpr uint16_t LATIN_BASE_FIRST = 0x00A0;
+constexpr uint16_t TABLE_SIZE = 0x0180;
+static_assert(sizeof(LATIN_BASE) - 1 == TABLE_SIZE - LATIN_BASE_FIRST, "one stand-in per code point");
+
+constexpr uint8_t romCode(const uint16_t codepoint, const uint8_t i = 0) {
+    return i == ROM_CHAR_COUNT ? 0
+         : ROM_CHARS[i].codepoint == codepoint ? ROM_CHARS[i].code
+         : romCode(codepoint, i + 1);
+}
+
+constexpr uint8_t glyphIndex(const uint16_t codepoint, const uint8_t i = 0) {
+    return i == LCD_GLYPH_COUNT ? 0xFF
+         : GLYPHS[i].codepoint == codepoint ? i
+         : glyphIndex(codepoint, i + 1);
+}
+
+// Display code for U+0000-U+017F
+constexpr uint8_t codeFor(const uint16_t c) {
+    return c < 0x20 ? ' '
+         : c == '\\' ? '/'  // the ROM has yen and an arrow for these two
+         : c == '~' ? '-'
+         : c < 0x7F ? c
+         : c < LATIN_BASE_FIRST ? ' '
+         : romCode(c) ? romCode(c)
+         : glyphIndex(c) != 0xFF ? LCD_GLYPH_FIRST + glyphIndex(c)
+         : LATIN_BASE[c - LATIN_BASE_FIRST];
+}
+
+constexpr char romBase(const uint8_t code, const uint8_t i = 0) {
+    return i == ROM_CHAR_COUNT ? '?'
+         : ROM_CHARS[i].code == code ? ROM_CHARS[i].base
+         : romBase(code, i + 1);
+}
+
+// Stand-in for display code 0x80 + i
+constexpr uint8_t baseFor(const uint16_t i) {
+    return i < LCD_GLYPH_COUNT ? LATIN_BASE[GLYPHS[i].codepoint - LATIN_BASE_FIRST] : romBase(0x80 + i);
+}
+
+struct CodeRule {
+    static constexpr uint8_t at(const uint16_t i) { return codeFor(i); }
+};
+
+struct BaseRule {
+    static constexpr uint8_t at(const uint16_t i) { return baseFor(i); }
+};
+
+// Tables filled in by the compiler from the rules above, one entry per index
+template<uint16_t... I> struct Indices {};
+template<uint16_t N, uint16_t... I> struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+template<uint16_t... I> struct MakeIndices<0, I...> {
+    typedef Indices<I...> type;
+};
+
+template<typename Rule, typename Indices> struct Table;
+template<typename Rule, uint16_t... I> struct Table<Rule, Indices<I...>> {
+    static const uint8_t values[sizeof...(I)];
+};
+template<typename Rule, uint16_t... I>
+const uint8_t Table<Rule, Indices<I...>>::values[sizeof...(I)] = {Rule::at(I)...};
+
+typedef Table<CodeRule, MakeIndices<TABLE_SIZE>::type> CodeTable;
+typedef Table<BaseRule, MakeIndices<0x80>::type> BaseTable;
+
+// Next code point of UTF-8 text; false if the bytes are not valid UTF-8
+bool nextUtf8(const uint8_t* text, const size_t length, size_t& i, uint32_t& codepoint) {
+    const uint8_t lead = text[i++];
+    if (lead < 0x80) {
+        codepoint = lead;
+        return true;
+    }
+    const uint8_t extra = lead >= 0xF8 ? 0 : lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : 0;
+    if (extra == 0) return false;
+    codepoint = lead & (0x3F >> extra);
+    for (uint8_t k = 0; k < extra; k++) {
+        if (i >= length || (text[i] & 0xC0) != 0x80) return false;
+        codepoint = (codepoint << 6) | (text[i++] & 0x3F);
+    }
+    return true;
+}
+
+bool validUtf8(const uint8_t* text, const size_t length) {
+    size_t i = 0;
+    uint32_t codepoint;
+    while (i < length && text[i] != 0) {
+        if (!nextUtf8(text, length, i, codepoint)) return false;
+    }
+    return true;
+}
+
+}
+
+uint8_t lcdCode(const uint32_t codepoint) {
+    if (codepoint < TABLE_SIZE) return CodeTable::values[codepoint];
+    if (codepoint <= 0xFFFF) {
+        const uint8_t rom = romCode(codepoint);
+        if (rom) return rom;
+    }
+    switch (codepoint) {
+        case 0x2010: case 0x2011: case 0x2012: case 0x2013: case 0x2014: case 0x2015:
+            return '-';
+        case 0x2018: case 0x2019: case 0x201A: case 0x201B: case 0x2032:
+            return '\'';
+        case 0x201C: case 0x201D: case 0x201E: case 0x201F: case 0x2033:
+            return '"';
+        case 0x2026:
+            return '.';
+        case 0x2044:
+            return '/';
+        case 0x20AC:
+            return 'E';
+        default:
+            return '?';
+    }
+}
+
+const uint8_t* lcdGlyphRows(const char code) {
+    return GLYPHS[(static_cast<uint8_t>(code) - LCD_GLYPH_FIRST) % LCD_GLYPH_COUNT].rows;
+}
+
+char lcdBaseChar(const char code) {
+    const uint8_t value = static_cast<uint8_t>(code);
+    return value < 0x80 ? code : static_cast<char>(BaseTable::values[value - 0x80]);
+}
+
+size_t lcdTranscode(const char* text, const size_t length, TextEncoding encoding, char* out, const size_t size) {
+    if (size == 0) return 0;
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(text);
+    if (encoding == TextEncoding::UNKNOWN) {
+        encoding = validUtf8(in, length) ? TextEncoding::UTF8 : TextEncoding::LATIN1;
+    }
+
+    size_t i = 0;
+    bool bigEndian = true;
+    if (encoding == TextEncoding::UTF16 && length >= 2) {
+        if (in[0] == 0xFF && in[1] == 0xFE) {
+            bigEndian = false;
+            i = 2;
+        } else if (in[0] == 0xFE && in[1] == 0xFF) {
+            i = 2;
+        }
+    }
+
+    // Each code point takes at least one byte, so writing never overtakes
+    // reading when out is text
+    size_t count = 0;
+    while (i < length && count < size - 1) {
+        uint32_t codepoint;
+        switch (encoding) {
+            case TextEncoding::UTF16:
+            case TextEncoding::UTF16BE:
+                if (i + 1 >= length) {
+                    codepoint = 0;
+                    break;
+                }
+                codepoint = bigEndian ? (in[i] << 8) | in[i + 1] : in[i] | (in[i + 1] << 8);
+                i += 2;
+                if (codepoint >= 0xD800 && codepoint < 0xDC00) {
+                    // Beyond the Basic Multilingual Plane; skip the low half
+                    if (i + 1 < length) i += 2;
+                    codepoint = 0xFFFD;
+                }
+                break;
+            case TextEncoding::UTF8:
+                if (!nextUtf8(in, length, i, codepoint)) codepoint = 0xFFFD;
+                break;
+            default:
+                codepoint = in[i++];
+                break;
+        }
+        if (codepoint == 0) break;
+        out[count++] = static_cast<char>(lcdCode(codepoint));
+    }
+    out[count] = '\0';
+    return count;
+}
@@ -0,0 +1,825 @@
+#include "library.h"
+#include <storage.h>
+#include <metadata_parser.h>
+#include <catalog.h>
+#include <collation.h>
+#include <dir_listing.h>
+#include <lcd_charset.h>
+#include <sort.h>
+#include <new>
+
+// Catalog of all albums on the card, paged in through a small window
+static Catalog catalog;
+static constexpr uint8_t ALBUM_WINDOW = 8;
+static Album album_window[ALBUM_WINDOW];
+static uint16_t window_start = 0;
+static uint8_t window_count = 0;
+
+// The album currently loaded for playback (the only one with songs in RAM)
+static Album playing_album;
+
+// Initial arena size per song: a title, an 8.3 filename, and the artist and
+// album names, which are usually shared by every song
+static constexpr uint16_t SONG_TEXT_ESTIMATE = 48;
+
+// ============================================================================
+// SORTING
+// ============================================================================
+
+// Songs with track numbers first, in track order, then by filename
+static bool songBefore(const Album& album, const Song& a, const Song& b, const bool byTrack) {
+    if (byTrack && a.trackNumber != b.trackNumber) {
+        if (a.trackNumber == 0) return false;
+        if (b.trackNumber == 0) return true;
+        return a.trackNumber < b.trackNumber;
+    }
+    return collate(album.text(a.filename), album.text(b.filename)) < 0;
+}
+
+// Sort an album's songs through an index, then move each song once
+static void sortSongs(Album& album, const bool byTrack) {
+    uint8_t order[MAX_SONGS_PER_ALBUM];
+    for (uint8_t i = 0; i < album.song_count; i++) {
+        order[i] = i;
+    }
+    const Song* songs = album.songs;
+    heapSort(order, album.song_count, [&](const uint8_t a, const uint8_t b) {
+        if (songBefore(album, songs[a], songs[b], byTrack)) return true;
+        if (songBefore(album, songs[b], songs[a], byTrack)) return false;
+        return a < b;
+    });
+    applyPermutation(album.songs, order, album.song_count);
+}
+
+// ============================================================================
+// LAZY LOADING IMPLEMENTATION
+// ============================================================================
+
+// Album loading in progress: songs are listed up front, then parsed one per
+// loadAlbumStep() in directory order
+struct AlbumLoadJob {
+    Album* album = nullptr;
+    StorageFile dir;
+    StringInterner interner;
+    uint8_t parsed = 0;
+    uint8_t tracksWithNumbers = 0;
+    bool hasValidTrackNumbers = false;
+};
+
+static AlbumLoadJob load_job;
+
+static void endAlbumLoad() {
+    if (load_job.dir) {
+        load_job.dir.close();
+    }
+    load_job.album = nullptr;
+}
+
+// List an album's songs, with the filename standing in for the title until
+// each song is parsed
+bool beginAlbumLoad(Album* album) {
+    if (!album) return false;
+    if (album->loaded) return true;
+    if (load_job.album) endAlbumLoad();
+
+    Serial.print("Loading songs for: ");
+    Serial.println(album->title);
+
+    StorageFile dir = openDirectory(album->path);
+    if (!dir) {
+        Serial.print("Failed to open: ");
+        Serial.println(album->path);
+        return false;
+    }
+
+    // List the files first
+    DirListing listing;
+    listing.read(dir);
+    if (listing.audioCount() == 0) {
+        dir.close();
+        return false;
+    }
+
+    // Allocate the songs array and the text arena. The arena grows if the
+    // estimate is short, and is trimmed to size once everything is loaded.
+    uint8_t const allocCount = min(listing.audioCount(), static_cast<uint16_t>(MAX_SONGS_PER_ALBUM));
+    album->songs = new (std::nothrow) Song[allocCount];
+    if (!album->songs || !album->strings.reserve(allocCount * SONG_TEXT_ESTIMATE)) {
+        Serial.println("Failed to allocate songs!");
+        album->unload();
+        dir.close();
+        return false;
+    }
+    load_job.interner.reset(album->strings);
+    const TextRef albumArtist = load_job.interner.intern(album->artist);
+    const TextRef albumTitle = load_job.interner.intern(album->title);
+
+    uint8_t songIndex = 0;
+    for (uint16_t i = 0; i < listing.count() && songIndex < allocCount; i++) {
+        const DirEntry& entry = listing[i];
+        if (!entry.isAudio) continue;
+        Song& song = album->songs[songIndex++];
+        const char* name = listing.name(entry);
+        song.filename = album->strings.add(name);
+        // The title is shown, so it is kept in display codes; the filename
+        // still opens the file
+        char title[STORAGE_NAME_LEN];
+        lcdTranscode(name, strlen(name), TextEncoding::UNKNOWN, title, sizeof(title));
+        song.title = strcmp(title, name) == 0 ? song.filename : album->strings.add(title);
+        song.artist = albumArtist;
+        song.album = albumTitle;
+    }
+    listing.clear();
+
+    album->song_count = songIndex;
+    album->loaded = true;
+    // Filename order until the track numbers are known
+    sortSongs(*album, false);
+
+    // Second and last pass: loadAlbumStep() opens the songs as it goes
+    rewindEntries(dir);
+    load_job.album = album;
+    load_job.dir.take(dir);
+    load_job.parsed = 0;
+    load_job.tracksWithNumbers = 0;
+    load_job.hasValidTrackNumbers = false;
+    return true;
+}
+
+static Song* findSong(Album& album, const char* filename) {
+    for (uint8_t i = 0; i < album.song_count; i++) {
+        if (strcmp(album.text(album.songs[i].filename), filename) == 0) {
+            return &album.songs[i];
+        }
+    }
+    return nullptr;
+}
+
+static void parseSong(StorageFile& entry, Song& song) {
+    Album& album = *load_job.album;
+    SongMetadata metadata;
+    if (!parseMetadata(entry, metadata)) return; // keep the filename
+
+    if (metadata.title.length() > 0) {
+        song.title = album.strings.add(metadata.title.c_str(), metadata.title.length());
+    }
+    if (metadata.artist.length() > 0) {
+        song.artist = load_job.interner.intern(metadata.artist);
+    }
+    if (metadata.album.length() > 0) {
+        song.album = load_job.interner.intern(metadata.album);
+    }
+    song.duration = metadata.duration;
+    song.trackNumber = metadata.trackNumber;
+
+    if (metadata.trackNumber > 0) {
+        load_job.tracksWithNumbers++;
+        // Consider track numbers valid if they're reasonable
+        // (not impossibly high for a normal album)
+        if (metadata.trackNumber <= 99) {
+            load_job.hasValidTrackNumbers = true;
+        }
+    }
+}
+
+// All songs parsed: put them in play order
+static void finishAlbumLoad() {
+    Album* album = load_job.album;
+    endAlbumLoad();
+    album->strings.shrink();
+
+    // Sort by track number if we have valid track numbers for at least half the songs,
+    // otherwise by filename
+    const uint8_t tracksWithNumbers = load_job.tracksWithNumbers;
+    const bool byTrack = load_job.hasValidTrackNumbers && (tracksWithNumbers >= (album->song_count + 1) / 2);
+    sortSongs(*album, byTrack);
+    if (byTrack) {
+        Serial.print("Sorted ");
+        Serial.print(tracksWithNumbers);
+        Serial.print("/");
+        Serial.print(album->song_count);
+        Serial.println(" songs by track number");
+    } else if (tracksWithNumbers > 0) {
+        Serial.print("Skipping sort: only ");
+        Serial.print(tracksWithNumbers);
+        Serial.print("/");
+        Serial.print(album->song_count);
+        Serial.println(" songs have track numbers, sorted by filename");
+    } else {
+        Serial.println("No track numbers found, sorted by filename");
+    }
+
+    Serial.println("Play order:");
+    for (uint8_t i = 0; i < album->song_count; i++) {
+        Serial.print("  ");
+        Serial.print(i + 1);
+        Serial.print(". ");
+        if (album->songs[i].trackNumber > 0) {
+            Serial.print("[Track ");
+            Serial.print(album->songs[i].trackNumber);
+            Serial.print("] ");
+        }
+        Serial.println(album->text(album->songs[i].title));
+    }
+
+    Serial.print("Loaded ");
+    Serial.print(album->song_count);
+    Serial.print(" songs, ");
+    Serial.print(album->strings.size());
+    Serial.println(" bytes of text");
+}
+
+bool loadAlbumStep() {
+    if (!load_job.album) return false;
+
+    StorageFile entry;
+    char name[STORAGE_NAME_LEN];
+    while (openNextEntry(load_job.dir, entry)) {
+        if (entry.isDirectory() || !entry.getName(name, sizeof(name)) || !isAudioFile(name)) {
+            continue;
+        }
+        Song* song = findSong(*load_job.album, name);
+        if (song) {
+            parseSong(entry, *song);
+            load_job.parsed++;
+        }
+        entry.close();
+        if (load_job.parsed < load_job.album->song_count) {
+            return true;
+        }
+        break;
+    }
+    entry.close();
+
+    finishAlbumLoad();
+    return false;
+}
+
+bool albumLoadPending(const Album* album) {
+    return load_job.album != nullptr && load_job.album == album;
+}
+
+bool loadAlbumSongs(Album* album) {
+    if (!beginAlbumLoad(album)) return false;
+    while (loadAlbumStep()) {
+    }
+    return true;
+}
+
+// Copy a string into a fixed, always terminated field
+static void copyField(char* dest, const char* src, const size_t size) {
+    strncpy(dest, src, size - 1);
+    dest[size - 1] = '\0';
+}
+
+static void copyField(char* dest, const String& src, const size_t size) {
+    copyField(dest, src.c_str(), size);
+}
+
+// Copy a file or directory name into a field, as display codes
+static void copyName(char* dest, const char* name, const size_t size) {
+    lcdTranscode(name, strlen(name), TextEncoding::UNKNOWN, dest, size);
+}
+
+// Fill a catalog record from a directory (only reads first song for metadata)
+bool registerAlbumFromDir(StorageFile& firstAudio, const char* path, CatalogRecord& record) {
+    if (!firstAudio) {
+        return false;
+    }
+
+    // Parse metadata from the first file
+    SongMetadata metadata;
+    const bool hasMetadata = parseMetadata(firstAudio, metadata);
+
+    // Create an album entry
+    memset(&record, 0, sizeof(record));
+    copyField(record.path, path, sizeof(record.path));
+
+    if (hasMetadata) {
+        if (metadata.album.length() > 0) {
+            copyField(record.title, metadata.album, sizeof(record.title));
+        } else {
+            copyName(record.title, path, sizeof(record.title));
+        }
+        copyField(record.artist, metadata.artist.length() > 0 ? metadata.artist : "Unknown Artist", sizeof(record.artist));
+        record.expected_song_count = metadata.totalTracks;
+    } else {
+        // Fallback to directory name
+        const char* lastSlash = strrchr(path, '/');
+        copyName(record.title, lastSlash ? lastSlash + 1 : path, sizeof(record.title));
+        copyField(record.artist, "Unknown Artist", sizeof(record.artist));
+        record.expected_song_count = 0;
+    }
+
+    Serial.print("Found album: ");
+    Serial.print(record.artist);
+    Serial.print(" - ");
+    Serial.println(record.title);
+
+    return true;
+}
+
+// ============================================================================
+// CATALOG SCAN
+// ============================================================================
+
+// Compact sort key kept in RAM for every album while scanning: the start of
+// the artist's collation key, a 0 separator, then the title's. Albums with
+// equal prefixes are put in order from the full catalog records.
+struct AlbumSortKey {
+    uint8_t prefix[12];
+    uint16_t record;
+};
+
+// Albums with equal key prefixes whose names are compared in RAM. Longer
+// runs of equal prefixes are compared by reading the records each time.
+static constexpr uint8_t TIE_BUFFER = 16;
+
+// How far ahead in the previous catalog to look for a directory before
+// treating it as new. Directories are normally visited in the same order
+// as the last scan, so only inserted/removed albums move the cursor.
+static constexpr uint8_t CATALOG_LOOKAHEAD = 8;
+
+// One directory being walked, with the subdirectories still to visit
+struct ScanFrame {
+    DirListing listing;
+    uint16_t next = 0;        // next listing entry to look at
+    uint8_t pathLength = 0;   // length of this directory's path
+};
+
+// The last two records read back from the new catalog while sorting
+struct SortCache {
+    CatalogRecord records[2];
+    uint16_t cached[2] = {0xFFFF, 0xFFFF};
+    uint8_t next = 0;
+
+    void reset() { *this = SortCache(); }
+};
+
+struct ScanState {
+    Catalog previous;       // catalog written by the last scan
+    uint16_t cursor = 0;    // next previous record expected
+    CatalogWriter writer;
+    bool writing = false;   // the library differs from the previous catalog
+    uint16_t count = 0;     // albums found so far
+    AlbumSortKey* keys = nullptr;
+    uint16_t keyCapacity = 0;
+    StorageFile sortFile;
+    SortCache sortCache;    // records of sortFile
+    bool full = false;
+    // Directory walk: the path of the current directory, and one frame per level
+    char path[ALBUM_PATH_LEN];
+    ScanFrame frames[MAX_SCAN_DEPTH + 1];
+};
+
+static ScanState* scan_state = nullptr;
+
+static void makeSortKey(const CatalogRecord& record, const uint16_t index, AlbumSortKey& key) {
+    const uint8_t length = collationKey(record.artist, key.prefix, sizeof(key.prefix));
+    if (length + 1u < sizeof(key.prefix)) {
+        collationKey(record.title, key.prefix + length + 1, sizeof(key.prefix) - length - 1);
+    }
+    key.record = index;
+}
+
+// Start writing a new catalog, carrying over the records accepted so far
+// (which are identical to the start of the previous catalog)
+static bool divergeFromCatalog(ScanState& state) {
+    if (state.writing) return true;
+    state.writing = true;
+
+    const char* path = strcmp(state.previous.path(), CATALOG_PATH) == 0 && state.previous.isOpen()
+                       ? CATALOG_ALT_PATH : CATALOG_PATH;
+    if (!state.writer.begin(path, state.previous.generation() + 1)) return false;
+
+    CatalogRecord record;
+    for (uint16_t i = 0; i < state.count; i++) {
+        if (!state.previous.readRecord(i, record) || !state.writer.append(record)) return false;
+    }
+    return true;
+}
+
+static void addAlbumRecord(ScanState& state, const CatalogRecord& record) {
+    if (state.count >= state.keyCapacity) {
+        const uint16_t capacity = min(static_cast<uint16_t>(state.keyCapacity + 64), MAX_ALBUMS);
+        auto* keys = static_cast<AlbumSortKey*>(realloc(state.keys, capacity * sizeof(AlbumSortKey)));
+        if (!keys) {
+            Serial.println("Out of memory for album list!");
+            state.full = true;
+            return;
+        }
+        state.keys = keys;
+        state.keyCapacity = capacity;
+    }
+
+    if (state.writing) {
+        state.writer.append(record);
+    }
+    makeSortKey(record, state.count, state.keys[state.count]);
+    state.count++;
+    if (state.count >= MAX_ALBUMS) {
+        Serial.println("Max albums reached!");
+        state.full = true;
+    }
+}
+
+// Look for a directory in the previous catalog near the cursor
+static int32_t findPreviousRecord(ScanState& state, const char* path, CatalogRecord& record) {
+    const uint16_t end = min(static_cast<uint16_t>(state.cursor + CATALOG_LOOKAHEAD), state.previous.count());
+    for (uint16_t i = state.cursor; i < end; i++) {
+        if (state.previous.readRecord(i, record) && strcmp(path, record.path) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Move the cursor past a directory's record in the previous catalog.
+// Anything other than the next record, unchanged, means a new catalog.
+static void advanceCursor(ScanState& state, const int32_t match, const bool unchanged) {
+    if (match != state.cursor || !unchanged) {
+        if (match > state.cursor) {
+            Serial.print("Albums removed: ");
+            Serial.println(match - state.cursor);
+        }
+        divergeFromCatalog(state);
+    }
+    if (match >= 0) {
+        state.cursor = match + 1;
+    }
+}
+
+// Take an album directory from the previous catalog without listing it, if
+// its timestamp has not changed since it was validated. Adding, removing or
+// renaming a file updates the directory's timestamp; rewriting one in place
+// does not, which is the price of not opening every album at boot.
+static bool trustAlbumDir(ScanState& state, const char* path, const uint32_t modified) {
+    if (modified == 0) return false;
+    CatalogRecord record;
+    const int32_t match = findPreviousRecord(state, path, record);
+    if (match < 0 || record.dir_modified != modified) return false;
+    advanceCursor(state, match, true);
+    addAlbumRecord(state, record);
+    return true;
+}
+
+// Check an album directory against the previous catalog, only parsing it if
+// it is new or its contents changed since the catalog was written
+void validateAlbumDir(DirListing& listing, const char* path, const DirFingerprint& fingerprint,
+                      const uint32_t modified) {
+    ScanState& state = *scan_state;
+    if (strlen(path) >= ALBUM_PATH_LEN) {
+        Serial.print("Path too long, skipping: ");
+        Serial.println(path);
+        return;
+    }
+
+    CatalogRecord record;
+    const int32_t match = findPreviousRecord(state, path, record);
+    const bool unchanged = match >= 0 &&
+                           record.dir_entries == fingerprint.entries &&
+                           record.dir_signature == fingerprint.signature;
+    // A new timestamp on the same contents is written out, so the album can
+    // be trusted next time
+    advanceCursor(state, match, unchanged && record.dir_modified == modified);
+
+    if (!unchanged) {
+        Serial.print(match >= 0 ? "Album changed: " : "New album: ");
+        Serial.println(path);
+        if (!registerAlbumFromDir(listing.firstAudio(), path, record)) return;
+        record.dir_entries = fingerprint.entries;
+        record.dir_signature = fingerprint.signature;
+    }
+    record.dir_modified = modified;
+
+    addAlbumRecord(state, record);
+}
+
+// Read a record back from the catalog being written, keeping the last two
+static const CatalogRecord* sortRecord(ScanState& state, const uint16_t index) {
+    SortCache& cache = state.sortCache;
+    for (uint8_t i = 0; i < 2; i++) {
+        if (cache.cached[i] == index) return &cache.records[i];
+    }
+    CatalogRecord& record = cache.records[cache.next];
+    cache.cached[cache.next] = 0xFFFF;
+    if (!state.sortFile.seek(static_cast<uint32_t>(index) * sizeof(CatalogRecord)) ||
+        state.sortFile.read(&record, sizeof(record)) != sizeof(record)) {
+        memset(&record, 0, sizeof(record));
+    } else {
+        cache.cached[cache.next] = index;
+    }
+    cache.next ^= 1;
+    return &record;
+}
+
+// Full album order: artist, then title, by collation key and then exactly
+static int compareAlbums(const char* artistA, const char* titleA, const char* artistB, const char* titleB) {
+    int cmp = compareKeys(artistA, artistB);
+    if (cmp == 0) cmp = compareKeys(titleA, titleB);
+    if (cmp == 0) cmp = strcmp(artistA, artistB);
+    if (cmp == 0) cmp = strcmp(titleA, titleB);
+    return cmp;
+}
+
+struct TieEntry {
+    char artist[ALBUM_TEXT_LEN];
+    char title[ALBUM_TEXT_LEN];
+    uint16_t record;
+};
+
+// Order a run of albums with equal key prefixes
+static void sortTiedAlbums(ScanState& state, AlbumSortKey* keys, const uint16_t count, TieEntry* ties) {
+    if (ties && count <= TIE_BUFFER) {
+        // Read each record once
+        uint8_t order[TIE_BUFFER];
+        for (uint8_t i = 0; i < count; i++) {
+            const CatalogRecord* record = sortRecord(state, keys[i].record);
+            memcpy(ties[i].artist, record->artist, ALBUM_TEXT_LEN);
+            memcpy(ties[i].title, record->title, ALBUM_TEXT_LEN);
+            ties[i].record = keys[i].record;
+            order[i] = i;
+        }
+        heapSort(order, count, [&](const uint8_t a, const uint8_t b) {
+            const int cmp = compareAlbums(ties[a].artist, ties[a].title, ties[b].artist, ties[b].title);
+            return cmp != 0 ? cmp < 0 : ties[a].record < ties[b].record;
+        });
+        for (uint8_t i = 0; i < count; i++) {
+            keys[i].record = ties[order[i]].record;
+        }
+        return;
+    }
+
+    heapSort(keys, count, [&](const AlbumSortKey& a, const AlbumSortKey& b) {
+        const CatalogRecord* recordA = sortRecord(state, a.record);
+        const CatalogRecord* recordB = sortRecord(state, b.record);
+        const int cmp = compareAlbums(recordA->artist, recordA->title, recordB->artist, recordB->title);
+        return cmp != 0 ? cmp < 0 : a.record < b.record;
+    });
+}
+
+// Sort albums alphabetically by artist, then by title
+static void sortAlbumKeys(ScanState& state) {
+    heapSort(state.keys, state.count, [](const AlbumSortKey& a, const AlbumSortKey& b) {
+        const int cmp = memcmp(a.prefix, b.prefix, sizeof(a.prefix));
+        return cmp != 0 ? cmp < 0 : a.record < b.record;
+    });
+
+    // Ties on the key prefix need the full records from the new catalog
+    state.writer.flush();
+    state.sortFile = storage.open(state.writer.path());
+    state.sortCache.reset();
+    auto* ties = static_cast<TieEntry*>(malloc(TIE_BUFFER * sizeof(TieEntry)));
+
+    uint16_t start = 0;
+    while (start < state.count) {
+        uint16_t end = start + 1;
+        while (end < state.count &&
+               memcmp(state.keys[start].prefix, state.keys[end].prefix, sizeof(AlbumSortKey::prefix)) == 0) {
+            end++;
+        }
+        if (end - start > 1) {
+            sortTiedAlbums(state, state.keys + start, end - start, ties);
+        }
+        start = end;
+    }
+
+    free(ties);
+    state.sortFile.close();
+    Serial.println("Albums sorted by artist/title");
+}
+
+// Append "/name" to the scan path. Returns false if it does not fit.
+static bool pushPath(ScanState& state, const char* name) {
+    const size_t length = strlen(state.path);
+    const size_t nameLength = strlen(name);
+    if (length + 1 + nameLength >= sizeof(state.path)) return false;
+    state.path[length] = '/';
+    memcpy(state.path + length + 1, name, nameLength + 1);
+    return true;
+}
+
+// List the directory at the scan path into a frame. An album is validated
+// right away; returns true if the directory has subdirectories to walk.
+// modified is the directory's timestamp from its parent's listing.
+static bool scanDirectory(ScanState& state, StorageFile& dir, ScanFrame& frame, const uint32_t modified) {
+    frame.next = 0;
+    frame.pathLength = strlen(state.path);
+
+    // One pass over the directory; an album's first audio file is kept open
+    // in case the album has to be registered
+    frame.listing.read(dir, true);
+    dir.close();
+
+    if (frame.listing.audioCount() > 0) {
+        // This directory is an album - register it
+        DirFingerprint fingerprint;
+        for (uint16_t i = 0; i < frame.listing.count(); i++) {
+            const DirEntry& entry = frame.listing[i];
+            fingerprint.add(frame.listing.name(entry), entry.size, entry.isDirectory);
+        }
+        validateAlbumDir(frame.listing, state.path, fingerprint, modified);
+        frame.listing.clear();
+        return false;
+    }
+    return frame.listing.hasSubdirs();
+}
+
+// Walk the card for albums, depth first in directory order. Iterative, with
+// one frame per level and a single path buffer, so deep or wide trees use a
+// fixed amount of stack. Returns false if the root could not be opened.
+bool scan_dir(ScanState& state) {
+    state.path[0] = '\0';
+    StorageFile root = openDirectory("/");
+    if (!root) return false;
+    int8_t depth = 0;
+    if (!scanDirectory(state, root, state.frames[0], 0)) return true;
+
+    while (depth >= 0 && !state.full) {
+        ScanFrame& frame = state.frames[depth];
+
+        // Next subdirectory of this level
+        const DirEntry* entry = nullptr;
+        while (frame.next < frame.listing.count()) {
+            const DirEntry& candidate = frame.listing[frame.next++];
+            if (candidate.isDirectory) {
+                entry = &candidate;
+                break;
+            }
+        }
+
+        if (!entry) {
+            // Done with this directory: back to the parent
+            frame.listing.clear();
+            depth--;
+            if (depth >= 0) {
+                state.path[state.frames[depth].pathLength] = '\0';
+            }
+            continue;
+        }
+
+        if (!pushPath(state, frame.listing.name(*entry))) {
+            Serial.print("Path too long, skipping: ");
+            Serial.println(frame.listing.name(*entry));
+            continue;
+        }
+        // Skip if the directory name starts with "TRASH"
+        bool descend = false;
+        if (depth + 1 <= MAX_SCAN_DEPTH && strncmp(state.path, "/TRASH", 6) != 0 &&
+            !trustAlbumDir(state, state.path, entry->modified)) {
+            StorageFile subdir = openDirectory(state.path);
+            if (subdir) {
+                descend = scanDirectory(state, subdir, state.frames[depth + 1], entry->modified);
+            }
+        }
+        if (descend) {
+            depth++;
+        } else {
+            state.path[frame.pathLength] = '\0';
+        }
+    }
+
+    // Stopped early (album limit)
+    for (ScanFrame& frame : state.frames) {
+        frame.listing.clear();
+    }
+    return true;
+}
+
+void scan_songs() {
+    // Drop everything derived from the old catalog
+    endAlbumLoad();
+    playing_album.unload();
+    window_count = 0;
+    catalog.close();
+
+    auto* state = new (std::nothrow) ScanState();
+    if (!state) {
+        Serial.println("Out of memory for scan!");
+        return;
+    }
+    scan_state = state;
+
+    // Start from the catalog written by the previous scan: album directories
+    // with the same timestamp are not listed, and only directories that
+    // changed since then have their metadata parsed again
+    state->previous.open();
+
+    if (!scan_dir(*state)) {
+        Serial.println("Failed to open root directory!");
+    } else if (!state->full && state->count != state->previous.count()) {
+        // Albums missing from the end of the previous catalog
+        divergeFromCatalog(*state);
+    }
+
+    if (state->writing) {
+        sortAlbumKeys(*state);
+        // Compact the sorted keys into the order table in place: entry i
+        // only overwrites keys that have already been read
+        auto* order = reinterpret_cast<uint16_t*>(state->keys);
+        for (uint16_t i = 0; i < state->count; i++) {
+            const uint16_t record = state->keys[i].record;
+            memcpy(order + i, &record, sizeof(record));
+        }
+        const bool saved = state->writer.finish(order, true);
+
+        // The new catalog replaces the old one
+        if (saved && state->previous.isOpen()) {
+            const char* oldPath = state->previous.path();
+            state->previous.close();
+            storage.remove(oldPath);
+        }
+    } else {
+        Serial.println("Catalog up to date");
+    }
+
+    state->previous.close();
+    free(state->keys);
+    delete state;
+    scan_state = nullptr;
+
+    catalog.open();
+
+    Serial.print("Scan complete: found ");
+    Serial.print(catalog.count());
+    Serial.println(" albums");
+}
+
+// ============================================================================
+// ALBUM ACCESS
+// ============================================================================
+
+uint16_t albumCount() {
+    return catalog.count();
+}
+
+const Album* albumAt(const uint16_t index) {
+    if (index >= catalog.count()) return nullptr;
+
+    if (index < window_start || index >= window_start + window_count) {
+        // Re-center the window on the requested album
+        const uint16_t count = catalog.count();
+        uint16_t start = index > ALBUM_WINDOW / 2 ? index - ALBUM_WINDOW / 2 : 0;
+        if (count >= ALBUM_WINDOW && start > count - ALBUM_WINDOW) {
+            start = count - ALBUM_WINDOW;
+        }
+        const uint8_t n = min(static_cast<uint16_t>(count - start), static_cast<uint16_t>(ALBUM_WINDOW));
+
+        uint16_t records[ALBUM_WINDOW];
+        window_count = 0;
+        if (!catalog.readOrder(start, records, n)) {
+            Serial.println("Failed to read catalog order!");
+            return nullptr;
+        }
+        CatalogRecord record;
+        for (uint8_t i = 0; i < n; i++) {
+            if (!catalog.readRecord(records[i], record)) {
+                Serial.println("Failed to read catalog record!");
+                return nullptr;
+            }
+            albumFromRecord(record, album_window[i]);
+            album_window[i].index = start + i;
+        }
+        window_start = start;
+        window_count = n;
+    }
+    return &album_window[index - window_start];
+}
+
+// Copy what the catalog knows of an album, not its songs or their text
+static void copyAlbumInfo(const Album& from, Album& to) {
+    memcpy(to.title, from.title, ALBUM_TEXT_LEN);
+    memcpy(to.artist, from.artist, ALBUM_TEXT_LEN);
+    memcpy(to.path, from.path, ALBUM_PATH_LEN);
+    to.index = from.index;
+    to.expected_song_count = from.expected_song_count;
+}
+
+Album* loadAlbum(const uint16_t index) {
+    if (playing_album.loaded && playing_album.index == index) {
+        return &playing_album;
+    }
+
+    const Album* album = albumAt(index);
+    if (!album) return nullptr;
+
+    // Only one album's songs are kept in memory
+    if (playing_album.loaded) {
+        Serial.print("Unloading album: ");
+        Serial.println(playing_album.title);
+    }
+    if (albumLoadPending(&playing_album)) {
+        endAlbumLoad();
+    }
+    playing_album.unload();
+    copyAlbumInfo(*album, playing_album);
+
+    if (!beginAlbumLoad(&playing_album)) {
+        // Leave nothing that passes for the album
+        static const Album none;
+        playing_album.unload();
+        copyAlbumInfo(none, playing_album);
+        return nullptr;
+    }
+    return &playing_album;
+}
@@ -1,12 +1,21 @@
 #include <Arduino.h>
 #include <Adafruit_VS1053.h>
-#include <SD.h>
-#include <metadata_parser.h>
+#include <storage.h>
+#include <SPI.h>
+#include <library.h>
 #include <lcd.h>
 #include <Adafruit_seesaw.h>
 #include <pindefs.h>
 #include <media.h>
-#include <new>
+#include <audio_feeder.h>
+#include <audio_core.h>
+#include <vs1053_output.h>
+#include <sdi_dma_port.h>
+#include <task_scheduler.h>
+#include <render_scheduler.h>
+#ifdef AUDIO_CORE1
+#include <pico/mutex.h>
+#endif
 
 #define DEBUG 0 // only enable for usb tethered operation
 
@@ -35,6 +44,34 @@ Adafruit_VS1053_FilePlayer musicPlayer =
         CARDCS
         );
 
+// Playback is fed from here rather than through the FilePlayer, so the next
+// song can be opened while the current one plays
+#ifdef SDI_DMA_SUPPORTED
+// Stream data is sent by DMA; card access waits for the burst in flight
+SdiDmaPort sdi_port(VS1053_DCS, VS1053_DREQ);
+SdiScheduler sdi(sdi_port);
+Vs1053DmaOutput audio_output(musicPlayer, sdi);
+#else
+Vs1053Output audio_output(musicPlayer);
+#endif
+AudioFeeder feeder(audio_output);
+void set_codec_volume(uint8_t volume);
+// Playback commands go through here, to core1 on the RP2040
+AudioCore audio_core(feeder, audio_output, set_codec_volume);
+#ifdef AUDIO_CORE1
+// The card and the decoder share the SPI bus, which both cores use
+auto_init_recursive_mutex(spi_bus_mutex);
+// Set once core0 has set up the decoder and the card
+std::atomic<bool> audio_core_started{false};
+#endif
+uint16_t seen_advances = 0;
+// Take the feeder's advances() as seen once the track just started is playing
+bool resync_advances = false;
+// An album was picked and is loading; playback starts once its first track is
+// known, or with album_start_last, once it is sorted and its last song is
+bool album_starting = false;
+bool album_start_last = false;
+
 Lcd lcd(LCD_I2C_ADDR);
 
 Adafruit_seesaw ss;
@@ -44,9 +81,6 @@ boolean sd_card_present = false;
 ButtonStates button_states = ButtonStates();
 boolean autoplay_enabled = false;
 
-// Album storage - only metadata, songs loaded on demand
-Album albums[MAX_ALBUMS];
-uint16_t n_albums = 0;
 uint16_t album_list_index = 0;
 Album* current_album = nullptr;
 Song* current_song = nullptr;
@@ -55,11 +89,26 @@ uint32_t elapsed = 0;
 unsigned long start_time = 0;
 double volume = 20.0; // 0 - 100
 uint8_t player_volume = 0; // 255 - 0
+bool volume_written = false;
 
 constexpr uint8_t N_BUTTONS = 4;
 unsigned long lastButtonPress[N_BUTTONS] = {0, 0, 0, 0};
 constexpr unsigned long DEBOUNCE_DELAY = 500;
 
+// loop() runs one task per pass; see setup() for the periods
+TaskScheduler scheduler;
+int8_t ui_task_id = -1;
+#ifdef BOOMERBOX_STATS
+// Profiling printed to Serial, for builds with -D BOOMERBOX_STATS
+constexpr uint32_t STATS_PERIOD_MS = 30000;
+#endif
+// A message on the LCD stays up until this runs out
+Timeout ui_hold;
+Timeout error_report;
+// The ui task checks this often whether a frame is due
+constexpr uint16_t UI_PERIOD_MS = 10;
+constexpr uint8_t UI_MAX_FPS = 10;
+RenderScheduler render(UI_MAX_FPS);
 
 void poll_inputs() {
     button_states.play = !ss.digitalRead(BTN_PLAY);
@@ -74,380 +123,205 @@ void poll_inputs() {
     autoplay_enabled = !digitalRead(AUTOPLAY_SWITCH);
 }
 
-// ============================================================================
-// SORTING
-// ============================================================================
-
-template<typename T>
-void insertionSort(T* arr, uint16_t count, int (*cmp)(const T&, const T&)) {
-    for (uint16_t i = 1; i < count; i++) {
-        T temp = arr[i];
-        int16_t j = i - 1;
-        while (j >= 0 && cmp(arr[j], temp) > 0) {
-            arr[j + 1] = arr[j];
-            j--;
-        }
-        arr[j + 1] = temp;
-    }
+// Only written when it changes, as each write is an SPI transaction
+void update_volume() {
+    const uint8_t level = static_cast<uint8_t>(200.0 - 200.0*pow(volume/100.0, 0.25));
+    if (volume_written && level == player_volume) return;
+    player_volume = level;
+    volume_written = true;
+    audio_core.setVolume(player_volume);
 }
 
-int compareAlbums(const Album& a, const Album& b) {
-    int cmp = a.artist.compareTo(b.artist);
-    return cmp != 0 ? cmp : a.title.compareTo(b.title);
+// On the audio side
+void set_codec_volume(const uint8_t volume) {
+    audio_output.setVolume(volume, volume);
 }
 
-int compareSongsByTrack(const Song& a, const Song& b) {
-    if (a.trackNumber > 0 && b.trackNumber > 0)
-        return (int)a.trackNumber - (int)b.trackNumber;
-    if (a.trackNumber > 0) return -1;
-    if (b.trackNumber > 0) return 1;
-    return 0;
+// Show an error for a couple of seconds, without holding up playback or input
+void show_error(const char* message) {
+    lcd.display_error(message);
+    ui_hold.start(2000);
+    // Put the screen back afterwards
+    render.invalidate();
 }
 
 // ============================================================================
-// LAZY LOADING IMPLEMENTATION
+// PLAYBACK
 // ============================================================================
 
-void unloadAlbumsExcept(const int16_t keepIndex) {
-    for (uint16_t i = 0; i < n_albums; i++) {
-        if (i != keepIndex && albums[i].loaded) {
-            Serial.print("Unloading album: ");
-            Serial.println(albums[i].title);
-            albums[i].unload();
-        }
-    }
+void play_next_song();
+void play_prev_song();
+void stop();
+bool play_album(uint16_t index, bool last = false);
+void start_album_song(bool sorted);
+void service_album_load();
+
+// Path of a song on the card
+void song_path(const Album* album, const uint8_t index, char (&path)[SONG_PATH_LEN]) {
+    snprintf(path, sizeof(path), "%s/%s", album->path, album->text(album->songs[index].filename));
 }
 
-// Count audio files in a directory (without loading metadata)
-uint8_t countAudioFiles(File& dir) {
-    uint8_t count = 0;
-    dir.rewindDirectory();
-    while (File entry = dir.openNextFile()) {
-        if (!entry.isDirectory() && isAudioFile(entry.name())) {
-            count++;
-            if (count >= MAX_SONGS_PER_ALBUM) {
-                entry.close();
-                break;
-            }
-        }
-        entry.close();
+// Open the song after the current one, so it starts the moment this one ends
+void queue_next_song() {
+    if (current_album && current_song_index + 1 < current_album->song_count) {
+        char filePath[SONG_PATH_LEN];
+        song_path(current_album, current_song_index + 1, filePath);
+        audio_core.queue(filePath);
+    } else {
+        audio_core.clearQueue();
     }
-    return count;
 }
 
-// Load full song details for an album
-bool loadAlbumSongs(Album* album) {
-    if (!album || album->loaded) return album != nullptr;
-
-    // First, unload other albums to free memory
-    int16_t albumIndex = -1;
-    for (uint16_t i = 0; i < n_albums; i++) {
-        if (&albums[i] == album) {
-            albumIndex = i;
-            break;
-        }
-    }
-    unloadAlbumsExcept(albumIndex);
-
-    Serial.print("Loading songs for: ");
-    Serial.println(album->title);
-
-    File dir = SD.open(album->path);
-    if (!dir) {
-        Serial.print("Failed to open: ");
-        Serial.println(album->path);
-        return false;
-    }
-
-    // Count files first
-    const uint8_t fileCount = countAudioFiles(dir);
-    if (fileCount == 0) {
-        dir.close();
-        return false;
-    }
+// Start a song of the current album right away
+bool start_song(const uint8_t index) {
+    album_starting = false;
+    current_song_index = index;
+    current_song = &current_album->songs[index];
+    elapsed = 0;
+    render.invalidate();
 
-    // Allocate the songs array
-    uint8_t const allocCount = min(fileCount, MAX_SONGS_PER_ALBUM);
-    album->songs = new (std::nothrow) Song[allocCount];
-    if (!album->songs) {
-        Serial.println("Failed to allocate songs!");
-        dir.close();
+    char filePath[SONG_PATH_LEN];
+    song_path(current_album, index, filePath);
+    Serial.print("Playing: ");
+    Serial.println(filePath);
+    start_time = millis();
+    if (!audio_core.play(filePath)) {
+        Serial.println("Failed to start playback!");
         return false;
     }
+    resync_advances = true;
+    queue_next_song();
+    return true;
+}
 
-    // Load each song
-    dir.rewindDirectory();
-    uint8_t songIndex = 0;
-    bool hasValidTrackNumbers = false;
-    uint8_t tracksWithNumbers = 0;
-
-    while (File entry = dir.openNextFile()) {
-        if (songIndex >= allocCount) {
-            entry.close();
-            break;
-        }
-
-        if (!entry.isDirectory() && isAudioFile(entry.name())) {
-            Song& song = album->songs[songIndex];
-            song.filename = entry.name();
-            SongMetadata metadata;
-            if (parseMetadata(entry, metadata)) {
-                song.title = metadata.title;
-                song.artist = metadata.artist;
-                song.album = metadata.album;
-                song.duration = metadata.duration;
-                song.trackNumber = metadata.trackNumber;
-                
-                if (metadata.trackNumber > 0) {
-                    tracksWithNumbers++;
-                    // Consider track numbers valid if they're reasonable
-                    // (not impossibly high for a normal album)
-                    if (metadata.trackNumber <= 99) {
-                        hasValidTrackNumbers = true;
-                    }
-                }
-            } else {
-                // Fallback to filename
-                song.title = entry.name();
-                song.artist = album->artist;
-                song.album = album->title;
-                song.trackNumber = 0;
-                song.duration = 0;
-            }
+// The feeder moved on to the queued song by itself
+void song_advanced() {
+    seen_advances++;
+    if (!current_album || current_song_index + 1 >= current_album->song_count) return;
 
-            songIndex++;
-        }
-        entry.close();
-    }
-
-    dir.close();
-    album->song_count = songIndex;
-    album->loaded = true;
-
-    // Sort by track number if we have valid track numbers for at least half the songs
-    if (hasValidTrackNumbers && (tracksWithNumbers >= (songIndex + 1) / 2)) {
-        insertionSort(album->songs, album->song_count, compareSongsByTrack);
-        
-        Serial.print("Sorted ");
-        Serial.print(tracksWithNumbers);
-        Serial.print("/");
-        Serial.print(album->song_count);
-        Serial.println(" songs by track number");
-    } else if (tracksWithNumbers > 0) {
-        Serial.print("Skipping sort: only ");
-        Serial.print(tracksWithNumbers);
-        Serial.print("/");
-        Serial.print(album->song_count);
-        Serial.println(" songs have track numbers");
-    } else {
-        Serial.println("No track numbers found, keeping load order");
-    }
+    current_song_index++;
+    current_song = &current_album->songs[current_song_index];
+    elapsed = 0;
+    start_time = millis();
+    render.invalidate();
+    Serial.print("Playing next: ");
+    Serial.println(current_album->text(current_song->filename));
+    queue_next_song();
+}
 
-    Serial.println("Play order:");
-    for (uint8_t i = 0; i < album->song_count; i++) {
-        Serial.print("  ");
-        Serial.print(i + 1);
-        Serial.print(". ");
-        if (album->songs[i].trackNumber > 0) {
-            Serial.print("[Track ");
-            Serial.print(album->songs[i].trackNumber);
-            Serial.print("] ");
-        }
-        Serial.println(album->songs[i].title);
-    }
+// DREQ interrupt, and DMA completion
+void feed_audio() {
+    feeder.feed();
+}
 
-    Serial.print("Loaded ");
-    Serial.print(album->song_count);
-    Serial.println(" songs");
+// Read ahead, and top up the decoder in case a DREQ edge was missed while
+// busy. With the audio on core1, that core does this by itself.
+void service_audio() {
+#ifndef AUDIO_CORE1
+    audio_core.service();
+#endif
+}
 
-    return true;
+#ifdef AUDIO_CORE1
+void claim_spi_bus() {
+    recursive_mutex_enter_blocking(&spi_bus_mutex);
 }
 
-// Register an album from a directory (only reads first song for metadata)
-bool registerAlbumFromDir(File& dir, const String& path) {
-    if (n_albums >= MAX_ALBUMS) {
-        Serial.println("Max albums reached!");
-        return false;
-    }
+void release_spi_bus() {
+    recursive_mutex_exit(&spi_bus_mutex);
+}
+#endif
 
-    // Look for the first audio file to get album metadata
-    File firstAudio;
-    bool found = false;
+#ifdef SDI_DMA_SUPPORTED
+void claim_sdi_bus() {
+    sdi.claimBus();
+}
 
-    dir.rewindDirectory();
-    while (File entry = dir.openNextFile()) {
-        if (!entry.isDirectory() && isAudioFile(entry.name())) {
-            firstAudio = entry;
-            found = true;
-            break;
-        }
-        entry.close();
-    }
+void release_sdi_bus() {
+    sdi.releaseBus();
+}
+#endif
 
-    if (!found) {
+// Start loading an album and play it once its first track is known, or its
+// last song with last. Returns false, with nothing playing, if it could not
+// be loaded.
+bool play_album(const uint16_t index, const bool last) {
+    Serial.println("play_album()");
+    const Album* entry = albumAt(index);
+    if (!entry) return false;
+
+    // Load songs (replaces the previously loaded album)
+    lcd.clear();
+    lcd.display_splash("Loading...", entry->title);
+
+    // Loading unloads the current album, whether or not it succeeds
+    Album* album = loadAlbum(index);
+    if (!album || album->song_count == 0) {
+        show_error(album ? "No songs!" : "Load failed!");
+        stop();
         return false;
     }
 
-    // Parse metadata from the first file
-    SongMetadata metadata;
-    const bool hasMetadata = parseMetadata(firstAudio, metadata);
-    firstAudio.close();
-
-    // Create an album entry
-    Album& album = albums[n_albums];
-    album.path = path;
-    album.songs = nullptr;
-    album.song_count = 0;
-    album.loaded = false;
-
-    if (hasMetadata) {
-        album.title = metadata.album.length() > 0 ? metadata.album : path;
-        album.artist = metadata.artist.length() > 0 ? metadata.artist : "Unknown Artist";
-        album.expected_song_count = metadata.totalTracks;
+    // The songs are parsed from loop(); see service_album_load(). The album
+    // may already be loaded, if it is the one that was playing.
+    current_album = album;
+    current_song = nullptr;
+    album_starting = true;
+    album_start_last = last;
+    if (albumLoadPending(album)) {
+        service_album_load();
     } else {
-        // Fallback to directory name
-        int lastSlash = path.lastIndexOf('/');
-        album.title = lastSlash >= 0 ? path.substring(lastSlash + 1) : path;
-        album.artist = "Unknown Artist";
-        album.expected_song_count = 0;
+        start_album_song(true);
     }
-
-    n_albums++;
-
-    Serial.print("Found album: ");
-    Serial.print(album.artist);
-    Serial.print(" - ");
-    Serial.println(album.title);
-
     return true;
 }
 
-// Sort albums alphabetically by artist, then by title
-void sortAlbums() {
-    insertionSort(albums, n_albums, compareAlbums);
-    Serial.println("Albums sorted by artist/title");
-}
-
-// Recursively scan directories for albums
-void scan_dir(File& dir, const String& path, uint8_t depth) {
-    if (depth > MAX_SCAN_DEPTH || n_albums >= MAX_ALBUMS) {
-        return;
-    }
-
-    // Skip if the directory name starts with "TRASH"
-    if (path.startsWith("/TRASH")) return;
-
-    bool hasAudioFiles = false;
-    bool hasSubdirs = false;
-
-    // First pass: check what this directory contains
-    while (File entry = dir.openNextFile()) {
-        if (entry.isDirectory()) {
-            hasSubdirs = true;
-        } else if (isAudioFile(entry.name())) {
-            hasAudioFiles = true;
-        }
-        entry.close();
-
-        // Early exit if we know it's an album
-        if (hasAudioFiles) break;
-    }
-
-    if (hasAudioFiles) {
-        // This directory is an album - register it
-        registerAlbumFromDir(dir, path);
-    } else if (hasSubdirs) {
-        // Recurse into subdirectories
-        dir.rewindDirectory();
-        while (File entry = dir.openNextFile()) {
-            if (entry.isDirectory()) {
-                String subPath = path.length() > 0 
-                    ? path + "/" + entry.name() 
-                    : String("/") + entry.name();
-                scan_dir(entry, subPath, depth + 1);
-            }
-            entry.close();
-
-            if (n_albums >= MAX_ALBUMS) break;
-        }
+// First song to play while the album is still loading: track 1 once it has
+// been parsed, otherwise wait for the album to be sorted
+int16_t find_first_song(const bool sorted) {
+    if (sorted) return 0;
+    for (uint8_t i = 0; i < current_album->song_count; i++) {
+        if (current_album->songs[i].trackNumber == 1) return i;
     }
+    return -1;
 }
 
-void scan_songs() {
-    // Clear existing albums
-    for (uint16_t i = 0; i < n_albums; i++) {
-        albums[i].unload();
-        albums[i].title = "";
-        albums[i].artist = "";
-        albums[i].path = "";
-    }
-    n_albums = 0;
-
-    File root = SD.open("/");
-    if (!root) {
-        Serial.println("Failed to open root directory!");
-        return;
+// Start the album once the song to start with is known
+void start_album_song(const bool sorted) {
+    const int16_t song = album_start_last ? (sorted ? current_album->song_count - 1 : -1)
+                                          : find_first_song(sorted);
+    if (song >= 0 && !start_song(song)) {
+        show_error("Playback failed!");
+        current_song = nullptr;
     }
-
-    scan_dir(root, "", 0);
-    root.close();
-
-    // Sort albums alphabetically by artist, then title
-    sortAlbums();
-
-    Serial.print("Scan complete: found ");
-    Serial.print(n_albums);
-    Serial.println(" albums");
 }
 
-// ============================================================================
-// PLAYBACK
-// ============================================================================
-
-void play_next_song();
-void play_prev_song();
-
-void play_album(Album* album) {
-    Serial.println("play_album()");
-    if (!album) return;
-
-    // Load songs if not already loaded
-    if (!album->loaded) {
-        lcd.clear();
-        lcd.display_splash("Loading...", album->title);
-
-        if (!loadAlbumSongs(album)) {
-            lcd.display_error("Load failed!");
-            delay(2000);
-            return;
+// Parse the next song of the album being loaded; the feeder plays from its
+// read-ahead meanwhile. Starts playback as soon as the first track is known,
+// and follows the playing song when the finished album is sorted.
+void service_album_load() {
+    if (!current_album || !albumLoadPending(current_album)) return;
+
+    const TextRef playing = current_song ? current_song->filename : 0;
+    const bool more = loadAlbumStep();
+    service_audio();
+
+    if (!more && current_song) {
+        // Sorting moved the songs
+        for (uint8_t i = 0; i < current_album->song_count; i++) {
+            if (current_album->songs[i].filename == playing) {
+                current_song_index = i;
+                current_song = &current_album->songs[i];
+                render.invalidate();
+                break;
+            }
         }
+        queue_next_song();
     }
 
-    if (album->song_count == 0) {
-        lcd.display_error("No songs!");
-        delay(2000);
-        return;
-    }
-
-    elapsed = 0;
-    current_album = album;
-    current_song_index = 0;
-    current_song = &album->songs[0];
-
-    const String filePath = album->path + "/" + current_song->filename;
-    Serial.print("Playing: ");
-    Serial.println(filePath);
-    start_time = millis();
-    if (!musicPlayer.startPlayingFile(filePath.c_str())) {
-        Serial.println("Failed to start playback!");
-        lcd.display_error("Playback failed!");
-        delay(2000);
-        current_song = nullptr;
-        return;
+    if (album_starting) {
+        start_album_song(!more);
     }
-    
-    // Give the player time to start
-    delay(1000);
 }
 
 void play_next_song() {
@@ -455,33 +329,22 @@ void play_next_song() {
     if (!current_album || !current_album->loaded) return;
 
     if (current_song_index < current_album->song_count - 1) {
-        current_song_index++;
-        current_song = &current_album->songs[current_song_index];
-        elapsed = 0;
-
-        const String filePath = current_album->path + "/" + current_song->filename;
-        Serial.print("Playing next: ");
-        Serial.println(filePath);
-        start_time = millis();
-        if (!musicPlayer.startPlayingFile(filePath.c_str())) { // interrupts wouldn't work. Maybe 2040 problem
-            Serial.println("Failed to start playback!");
+        if (!start_song(current_song_index + 1)) {
             // Try the next song
             play_next_song();
-            return;
         }
-        
-        // Give the player time to start
-        delay(50);
     } else {
         // End of album
         Serial.println("End of album");
         current_song = nullptr;
-        if (autoplay_enabled && album_list_index < n_albums - 1) {
+        // Albums that fail to load are skipped
+        while (autoplay_enabled && album_list_index < albumCount() - 1) {
             album_list_index++;
-            play_album(&albums[album_list_index]);
-        } else {
-            player_state = State::IDLE;
+            if (play_album(album_list_index)) return;
         }
+        stop();
+        player_state = State::IDLE;
+        render.invalidate();
     }
 }
 
@@ -492,30 +355,13 @@ void play_prev_song() {
     // If more than 5 seconds into the song, restart it
     if (elapsed > 5) {
         Serial.println("Restarting current song");
-        elapsed = 0;
-        start_time = millis();
-        const String filePath = current_album->path + "/" + current_song->filename;
-        musicPlayer.startPlayingFile(filePath.c_str());
-        delay(50);
+        start_song(current_song_index);
         return;
     }
 
     // If not at the first song, go to the previous song on this album
     if (current_song_index > 0) {
-        current_song_index--;
-        current_song = &current_album->songs[current_song_index];
-        elapsed = 0;
-
-        const String filePath = current_album->path + "/" + current_song->filename;
-        Serial.print("Playing prev: ");
-        Serial.println(filePath);
-        start_time = millis();
-        if (!musicPlayer.startPlayingFile(filePath.c_str())) {
-            Serial.println("Failed to start playback!");
-        }
-    
-        // Give the player time to start
-        delay(50);
+        start_song(current_song_index - 1);
         return;
     }
 
@@ -524,73 +370,66 @@ void play_prev_song() {
     if (autoplay_enabled && album_list_index > 0) {
         Serial.println("Going to previous album (last song)");
         album_list_index--;
-        Album* prevAlbum = &albums[album_list_index];
-
-        // Load the previous album if needed
-        if (!prevAlbum->loaded) {
-            lcd.clear();
-            lcd.display_splash("Loading...", prevAlbum->title);
-            if (!loadAlbumSongs(prevAlbum)) {
-                lcd.display_error("Load failed!");
-                delay(2000);
-                // Fall back to restarting the current song
-                elapsed = 0;
-                start_time = millis();
-                const String filePath = current_album->path + "/" + current_song->filename;
-                musicPlayer.startPlayingFile(filePath.c_str());
-                return;
-            }
-        }
 
-        current_album = prevAlbum;
-        current_song_index = current_album->song_count - 1;  // Last song
-        current_song = &current_album->songs[current_song_index];
-        elapsed = 0;
-
-        const String filePath = current_album->path + "/" + current_song->filename;
-        Serial.print("Playing last song of prev album: ");
-        Serial.println(filePath);
-        start_time = millis();
-        if (!musicPlayer.startPlayingFile(filePath.c_str())) {
-            Serial.println("Failed to start playback!");
+        // Loading the previous album replaces the current one
+        audio_core.stop();
+        if (!play_album(album_list_index, true)) {
+            player_state = State::IDLE;
         }
-        delay(50);
         return;
     }
 
     // At first song of first album, or autoplay disabled - restart current song
     Serial.println("At beginning, restarting current song");
-    elapsed = 0;
-    start_time = millis();
-    const String filePath = current_album->path + "/" + current_song->filename;
-    musicPlayer.startPlayingFile(filePath.c_str());
-    delay(50);
+    start_song(current_song_index);
 }
 
 void pause() {
     Serial.println("pause()");
-    musicPlayer.pausePlaying(true);
+    audio_core.pause(true);
 }
 
 void resume() {
     Serial.println("resume()");
-    musicPlayer.pausePlaying(false);
+    audio_core.pause(false);
 }
 
 void stop() {
     Serial.println("stop()");
-    musicPlayer.stopPlaying();
+    audio_core.stop();
     current_song = nullptr;
     current_album = nullptr;
+    album_starting = false;
 }
 
 // ============================================================================
 // SETUP & LOOP
 // ============================================================================
 
+void audio_task();
+void input_task();
+void ui_task();
+void load_task();
+#ifdef BOOMERBOX_STATS
+void stats_task();
+#endif
+
 void setup() {
     player_state = State::INITIALIZING;
     Serial.begin(115200);
+#ifndef AUDIO_CORE1
+    audio_core.runInline(true);
+#endif
+
+    // Audio first: it keeps the read-ahead full, and the decoder is fed from
+    // DREQ in between. Album loading runs whenever nothing else is due.
+    scheduler.add("audio", audio_task, 5, 0);
+    scheduler.add("input", input_task, 10, 1);
+    ui_task_id = scheduler.add("ui", ui_task, UI_PERIOD_MS, 2);
+#ifdef BOOMERBOX_STATS
+    scheduler.add("stats", stats_task, STATS_PERIOD_MS, 3);
+#endif
+    scheduler.add("load", load_task, 0, 4);
 
     #if DEBUG
         while (!Serial) { delay(1); }
@@ -630,17 +469,39 @@ void setup() {
         player_state = State::ERROR;
         return;
     }
-    musicPlayer.useInterrupt(VS1053_FILEPLAYER_PIN_INT);
+#ifdef SDI_DMA_SUPPORTED
+    if (!sdi_port.begin(sdi)) {
+        Serial.println("Failed to claim a DMA channel for the VS1053!");
+        player_state = State::ERROR;
+        return;
+    }
+    sdi.onIdle(feed_audio);
+    storage_bus.claim = claim_sdi_bus;
+    storage_bus.release = release_sdi_bus;
+#endif
+#ifdef AUDIO_CORE1
+    // core1 polls DREQ instead
+    storage_bus.claim = claim_spi_bus;
+    storage_bus.release = release_spi_bus;
+#else
+    // Feed the decoder from DREQ, as FilePlayer::useInterrupt() would
+    SPI.usingInterrupt(digitalPinToInterrupt(VS1053_DREQ));
+    attachInterrupt(digitalPinToInterrupt(VS1053_DREQ), feed_audio, CHANGE);
+#endif
     Serial.println("VS1053 initialized successfully!");
 
     Serial.println("Initializing SD card...");
-    if (!SD.begin(CARDCS)) {
+    if (!storage.begin(CARDCS)) {
         Serial.println("Failed to initialize SD card!");
         sd_card_present = false;
     } else {
         sd_card_present = true;
-        Serial.println("SD card initialized successfully!");
+        Serial.print("SD card initialized successfully: ");
+        Serial.println(storage.volumeType());
     }
+#ifdef AUDIO_CORE1
+    audio_core_started.store(true, std::memory_order_release);
+#endif
 
     if (sd_card_present) {
         lcd.display_splash("Music Box", "Scanning...");
@@ -651,7 +512,7 @@ void setup() {
     Serial.println("Ready to play!");
     player_state = State::IDLE;
     lcd.display_splash("Music Box", "Ready!");
-    delay(1000);
+    ui_hold.start(1000);
 }
 
 bool buttonReady(uint8_t button) {
@@ -663,37 +524,59 @@ bool buttonReady(uint8_t button) {
     }
 }
 
-void loop() {
+// Keep the audio going, and follow the feeder from track to track
+void audio_task() {
+    if (player_state != State::PLAYING) return;
+    service_audio();
+    // The feeder's state is only current once it has caught up with what
+    // was posted
+    if (!audio_core.settled()) return;
+    if (resync_advances) {
+        seen_advances = feeder.advances();
+        resync_advances = false;
+    }
+    if (feeder.advances() != seen_advances) {
+        song_advanced();
+    }
+    // Nothing left to play: the queue ran out (end of album or a song that
+    // could not be opened)
+    if (!feeder.playing() && !album_starting) {
+        play_next_song();
+    }
+}
+
+void input_task() {
     poll_inputs();
-    player_volume = static_cast<uint8_t>(200.0 - 200.0*pow(volume/100.0, 0.25));
-    musicPlayer.setVolume(player_volume, player_volume);
+    update_volume();
+    const State previous = player_state;
     switch (player_state) {
         case State::INITIALIZING:
             Serial.println("Player is in the initializing state, but it shouldn't be!");
             Serial.println("Moving to IDLE state.");
             player_state = State::IDLE;
-            delay(1000);
             break;
 
-        case State::IDLE:
+        case State::IDLE: {
+            const uint16_t n_albums = albumCount();
+            const uint16_t selected = album_list_index;
             if (button_states.up && buttonReady(2) && n_albums > 0) {
                 album_list_index = (album_list_index == 0) ? n_albums - 1 : album_list_index - 1;
             } else if (button_states.down && buttonReady(3) && n_albums > 0) {
                 album_list_index = (album_list_index >= n_albums - 1) ? 0 : album_list_index + 1;
             } else if (button_states.play && buttonReady(0) && n_albums > 0) {
-                play_album(&albums[album_list_index]);
-                player_state = State::PLAYING;
+                if (play_album(album_list_index)) player_state = State::PLAYING;
+            }
+            if (album_list_index != selected) {
+                render.flush();
+                scheduler.wake(ui_task_id);
             }
-            lcd.display_album_list(albums, n_albums, album_list_index);
             break;
+        }
 
-        case State::PLAYING:
-            // Check if the song finished - use stopped() for more reliable check
-            // Also add a small debouncing period to avoid false positives right after starting
-            if (musicPlayer.stopped()) {
-                play_next_song();
-            }
+        case State::PLAYING: {
+            const uint32_t was = elapsed;
             elapsed = (millis() - start_time) / 1000.0;
+            if (elapsed != was) render.invalidate();
             if (button_states.stop && buttonReady(1)) {
                 stop();
                 player_state = State::IDLE;
@@ -701,17 +584,12 @@ void loop() {
                 pause();
                 player_state = State::PAUSED;
             } else if (button_states.up && buttonReady(2)) {
-                musicPlayer.stopPlaying();
                 play_prev_song();
             } else if (button_states.down && buttonReady(3)) {
-                musicPlayer.stopPlaying();
                 play_next_song();
             }
-
-            if (current_song) {
-                lcd.display_playing(current_song, current_album, elapsed);
-            }
             break;
+        }
 
         case State::PAUSED:
             if (button_states.play && buttonReady(0)) {
@@ -721,9 +599,6 @@ void loop() {
                 stop();
                 player_state = State::IDLE;
             }
-            if (current_song) {
-                lcd.display_playing(current_song, current_album, elapsed);
-            }
             break;
 
         case State::STOPPED:
@@ -731,15 +606,95 @@ void loop() {
             break;
 
         case State::ERROR:
-            Serial.println("Player is in an error state!");
-            lcd.display_error("System Error");
-            delay(1000);
             break;
 
         default:
             Serial.println("Player is in an unknown state!");
             player_state = State::IDLE;
-            delay(1000);
             break;
     }
-}
\ No newline at end of file
+    // Show the new state right away
+    if (player_state != previous) {
+        render.flush();
+        scheduler.wake(ui_task_id);
+    }
+}
+
+void ui_task() {
+    if (player_state == State::ERROR && error_report.expired()) {
+        Serial.println("Player is in an error state!");
+        error_report.start(1000);
+        render.invalidate();
+    }
+    // An error or splash is still up
+    if (!ui_hold.expired()) return;
+    // Long lines move on with the next frame
+    if (!render.dirty() && lcd.scroll_due(millis())) render.invalidate();
+    if (!render.shouldRender()) return;
+
+    const uint32_t start = micros();
+    const LcdStats before = lcd.stats;
+    switch (player_state) {
+        case State::IDLE:
+            lcd.display_album_list(albumAt(album_list_index), albumCount(), album_list_index);
+            break;
+
+        case State::PLAYING:
+        case State::PAUSED:
+            if (current_song) {
+                lcd.display_playing(current_song, current_album, elapsed);
+            }
+            break;
+
+        case State::ERROR:
+            lcd.display_error("System Error");
+            break;
+
+        default:
+            break;
+    }
+    lcd.scroll(millis());
+    render.rendered(lcd.stats.cells - before.cells, lcd.stats.busUs - before.busUs, micros() - start);
+}
+
+void load_task() {
+    service_album_load();
+}
+
+#ifdef BOOMERBOX_STATS
+void stats_task() {
+    Serial.println("Task stats:");
+    scheduler.report(Serial);
+    scheduler.resetStats();
+    render.report(Serial);
+    render.resetStats();
+    Serial.print("LCD: ");
+    Serial.print(lcd.stats.transactions);
+    Serial.print(" I2C transactions, ");
+    Serial.print(lcd.stats.bytes);
+    Serial.print(" bytes, ");
+    Serial.print(lcd.stats.glyphs);
+    Serial.print(" glyphs loaded, ");
+    Serial.print(lcd.stats.errors);
+    Serial.println(" errors");
+    lcd.stats.reset();
+}
+#endif
+
+void loop() {
+    scheduler.runNext();
+}
+
+#ifdef AUDIO_CORE1
+// core1: nothing but playback. The bus is only taken while there is
+// something to do, so core0 gets it in between.
+void setup1() {
+}
+
+void loop1() {
+    if (!audio_core_started.load(std::memory_order_acquire) || !audio_core.hasWork()) return;
+    claim_spi_bus();
+    audio_core.service();
+    release_spi_bus();
+}
+#endif
@@ -1,4 +1,6 @@
 #include "metadata_parser.h"
+#include "block_reader.h"
+#include "lcd_charset.h"
 
 // Extract filename without path and extension for fallback title
 static String getFilenameWithoutExtension(const char* filepath) {
@@ -12,6 +14,14 @@ static String getFilenameWithoutExtension(const char* filepath) {
     return path.substring(lastSlash + 1, lastDot);
 }
 
+// Fallback title: the file's name without its extension
+static String fileTitle(StorageFile& file) {
+    char name[STORAGE_NAME_LEN];
+    if (!file.getName(name, sizeof(name))) return "";
+    lcdTranscode(name, sizeof(name), TextEncoding::UNKNOWN, name, sizeof(name));
+    return getFilenameWithoutExtension(name);
+}
+
 // Get file extension (lowercase)
 String getFileExtension(const char* filepath) {
     const String path = filepath;
@@ -22,36 +32,6 @@ String getFileExtension(const char* filepath) {
     return ext;
 }
 
-// Read a sync safe integer (used in ID3v2)
-static uint32_t readSyncSafeInt(File &file) {
-    uint8_t bytes[4];
-    file.read(bytes, 4);
-    return (static_cast<uint32_t>(bytes[0]) << 21) | (static_cast<uint32_t>(bytes[1]) << 14) |
-           (static_cast<uint32_t>(bytes[2]) << 7) | bytes[3];
-}
-
-// Read a big-endian 32-bit integer
-static uint32_t readBigEndian32(File &file) {
-    uint8_t bytes[4];
-    file.read(bytes, 4);
-    return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) |
-           (static_cast<uint32_t>(bytes[2]) << 8) | bytes[3];
-}
-
-// Read a little-endian 32-bit integer
-static uint32_t readLittleEndian32(File &file) {
-    uint32_t value;
-    file.read(&value, 4);
-    return value;
-}
-
-// Read a big-endian 24-bit integer
-static uint32_t readBigEndian24(File &file) {
-    uint8_t bytes[3];
-    file.read(bytes, 3);
-    return (static_cast<uint32_t>(bytes[0]) << 16) | (static_cast<uint32_t>(bytes[1]) << 8) | bytes[2];
-}
-
 static void parseTrackNumber(const char* str, uint8_t &trackNumber, uint8_t &totalTracks) {
     trackNumber = atoi(str);
     const char* slash = strchr(str, '/');
@@ -63,10 +43,10 @@ static void parseTrackNumber(const char* str, uint8_t &trackNumber, uint8_t &tot
 // Maximum iterations for parsing loops to prevent hangs
 static constexpr uint32_t MAX_PARSE_ITERATIONS = 500;
 
-bool parseWavMetadata(File &file, SongMetadata &metadata) {
+bool parseWavMetadata(StorageFile &file, SongMetadata &metadata) {
     if (!file) return false;
 
-    file.seek(0);
+    BlockReader reader(file);
 
     // Initialize with defaults
     metadata.title = "";
@@ -78,15 +58,14 @@ bool parseWavMetadata(File &file, SongMetadata &metadata) {
 
     // Check for RIFF header
     char header[4];
-    if (file.read(header, 4) != 4 || strncmp(header, "RIFF", 4) != 0) {
+    if (reader.read(header, 4) != 4 || strncmp(header, "RIFF", 4) != 0) {
         return false;
     }
 
-    uint32_t fileSize;
-    file.read(&fileSize, 4);
+    reader.skip(4); // RIFF size
 
     // Check for WAVE format
-    if (file.read(header, 4) != 4 || strncmp(header, "WAVE", 4) != 0) {
+    if (reader.read(header, 4) != 4 || strncmp(header, "WAVE", 4) != 0) {
         return false;
     }
 
@@ -96,24 +75,23 @@ bool parseWavMetadata(File &file, SongMetadata &metadata) {
     uint32_t dataSize = 0;
 
     char chunkId[5] = {0};
-    uint32_t chunkSize;
     char buffer[64];
 
     // Parse chunks
     uint32_t iterations = 0;
-    while (file.available() && iterations++ < MAX_PARSE_ITERATIONS) {
-        if (file.read(chunkId, 4) != 4) break;
-        if (file.read(&chunkSize, 4) != 4) break;
+    while (reader.remaining() >= 8 && iterations++ < MAX_PARSE_ITERATIONS) {
+        if (reader.read(chunkId, 4) != 4) break;
+        const uint32_t chunkSize = reader.read_u32le();
 
-        const uint32_t chunkStart = file.position();
+        const uint32_t chunkStart = reader.position();
 
         if (strncmp(chunkId, "fmt ", 4) == 0) {
             // Format chunk - needed for duration calculation
-            file.seek(chunkStart + 2); // Skip audio format
-            file.read(&channels, 2);
-            file.read(&sampleRate, 4);
-            file.seek(chunkStart + 14);
-            file.read(&bitsPerSample, 2);
+            reader.skip(2); // Skip audio format
+            channels = reader.read_u16le();
+            sampleRate = reader.read_u32le();
+            reader.seek(chunkStart + 14);
+            bitsPerSample = reader.read_u16le();
 
         } else if (strncmp(chunkId, "data", 4) == 0) {
             // Data chunk - needed for duration calculation
@@ -121,22 +99,22 @@ bool parseWavMetadata(File &file, SongMetadata &metadata) {
 
         } else if (strncmp(chunkId, "LIST", 4) == 0) {
             // LIST chunk may contain INFO metadata
-            if (file.read(header, 4) != 4) break;
+            if (reader.read(header, 4) != 4) break;
 
             if (strncmp(header, "INFO", 4) == 0) {
                 const uint32_t listEnd = chunkStart + chunkSize;
                 uint32_t infoIterations = 0;
 
-                while (file.position() < listEnd && infoIterations++ < MAX_PARSE_ITERATIONS) {
+                while (reader.position() < listEnd && infoIterations++ < MAX_PARSE_ITERATIONS) {
                     char infoId[5] = {0};
-                    uint32_t infoSize;
 
-                    if (file.read(infoId, 4) != 4) break;
-                    if (file.read(&infoSize, 4) != 4) break;
+                    if (reader.read(infoId, 4) != 4) break;
+                    const uint32_t infoSize = reader.read_u32le();
+                    const uint32_t infoStart = reader.position();
 
-                    const uint32_t readSize = min(infoSize, static_cast<uint32_t>(63));
-                    file.read(buffer, readSize);
-                    buffer[readSize] = '\0';
+                    const uint16_t readSize = reader.read(buffer, min(infoSize, static_cast<uint32_t>(63)));
+                    // INFO text has no declared encoding
+                    lcdTranscode(buffer, readSize, TextEncoding::UNKNOWN, buffer, sizeof(buffer));
 
                     if (strcmp(infoId, "INAM") == 0) {
                         metadata.title = buffer;
@@ -149,33 +127,196 @@ bool parseWavMetadata(File &file, SongMetadata &metadata) {
                     }
 
                     // Move to the next info chunk (account for padding)
-                    file.seek(file.position() - readSize + ((infoSize + 1) & ~1));
+                    if (!reader.seek(infoStart + ((infoSize + 1) & ~1))) break;
                 }
             }
         }
 
         // Move to the next chunk (chunks are word-aligned)
-        file.seek(chunkStart + ((chunkSize + 1) & ~1));
+        if (!reader.seek(chunkStart + ((chunkSize + 1) & ~1))) break;
     }
 
     // Calculate duration from audio data
     if (sampleRate > 0 && channels > 0 && bitsPerSample > 0) {
         const uint32_t bytesPerSample = (bitsPerSample / 8) * channels;
-        metadata.duration = dataSize / (sampleRate * bytesPerSample);
+        if (bytesPerSample > 0) {
+            metadata.duration = dataSize / (sampleRate * bytesPerSample);
+        }
     }
 
     // Fall back to filename if no title found
     if (metadata.title.length() == 0) {
-        metadata.title = getFilenameWithoutExtension(file.name());
+        metadata.title = fileTitle(file);
     }
 
     return true;
 }
 
-bool parseMp3Metadata(File &file, SongMetadata &metadata) {
+// MPEG audio frame header fields needed for duration calculation
+struct Mp3FrameHeader {
+    uint8_t version;       // 1 = MPEG1, 2 = MPEG2, 3 = MPEG2.5
+    uint8_t layer;         // 1, 2 or 3
+    uint8_t channelMode;   // 3 = mono
+    uint16_t bitrate;      // kbps
+    uint32_t sampleRate;   // Hz
+    uint16_t samplesPerFrame;
+    uint16_t frameLength;  // bytes, including the header
+};
+
+// Decode a 4-byte frame header. Returns false for reserved/free-format values.
+static bool decodeMp3FrameHeader(const uint8_t* h, Mp3FrameHeader &frame) {
+    if (h[0] != 0xFF || (h[1] & 0xE0) != 0xE0) return false;
+
+    const uint8_t versionBits = (h[1] >> 3) & 0x03;
+    const uint8_t layerBits = (h[1] >> 1) & 0x03;
+    const uint8_t bitrateIndex = (h[2] >> 4) & 0x0F;
+    const uint8_t sampleRateIndex = (h[2] >> 2) & 0x03;
+    const uint8_t padding = (h[2] >> 1) & 0x01;
+    if (versionBits == 1 || layerBits == 0 || bitrateIndex == 0 || bitrateIndex == 15 || sampleRateIndex == 3) {
+        return false;
+    }
+
+    // kbps, indexed by [table][bitrateIndex]
+    static const uint16_t bitrates[5][15] = {
+        {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448}, // MPEG1 Layer 1
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},    // MPEG1 Layer 2
+        {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},     // MPEG1 Layer 3
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},    // MPEG2/2.5 Layer 1
+        {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160}          // MPEG2/2.5 Layer 2 & 3
+    };
+    static const uint16_t sampleRates[3] = {44100, 48000, 32000};
+
+    frame.version = versionBits == 3 ? 1 : (versionBits == 2 ? 2 : 3);
+    frame.layer = 4 - layerBits;
+    frame.channelMode = (h[3] >> 6) & 0x03;
+
+    const uint8_t table = frame.version == 1 ? frame.layer - 1 : (frame.layer == 1 ? 3 : 4);
+    frame.bitrate = bitrates[table][bitrateIndex];
+    frame.sampleRate = sampleRates[sampleRateIndex] >> (frame.version - 1);
+
+    if (frame.layer == 1) {
+        frame.samplesPerFrame = 384;
+        frame.frameLength = (12000UL * frame.bitrate / frame.sampleRate + padding) * 4;
+    } else if (frame.layer == 2 || frame.version == 1) {
+        frame.samplesPerFrame = 1152;
+        frame.frameLength = 144000UL * frame.bitrate / frame.sampleRate + padding;
+    } else {
+        frame.samplesPerFrame = 576;
+        frame.frameLength = 72000UL * frame.bitrate / frame.sampleRate + padding;
+    }
+    return frame.frameLength > 4;
+}
+
+// Find the next frame header within limit bytes of the current position.
+// A candidate only counts if another compatible header follows it, which
+// rules out stray sync patterns in tag data. The reader is left at the
+// frame start on success.
+static bool findMp3Frame(BlockReader &reader, const uint32_t limit, const uint32_t audioEnd, Mp3FrameHeader &frame) {
+    static const uint8_t sync = 0xFF;
+    const uint32_t searchEnd = min(reader.position() + limit, audioEnd);
+
+    while (reader.position() < searchEnd && reader.find(&sync, 1, searchEnd - reader.position())) {
+        const uint32_t frameStart = reader.position();
+        uint8_t h[4];
+        if (reader.read(h, 4) == 4 && decodeMp3FrameHeader(h, frame)) {
+            const uint32_t nextFrame = frameStart + frame.frameLength;
+            Mp3FrameHeader next{};
+            if (nextFrame + 4 > audioEnd) {
+                // Last frame in the file, nothing to cross-check against
+                reader.seek(frameStart);
+                return true;
+            }
+            reader.seek(nextFrame);
+            if (reader.read(h, 4) == 4 && decodeMp3FrameHeader(h, next) &&
+                next.version == frame.version && next.layer == frame.layer && next.sampleRate == frame.sampleRate) {
+                reader.seek(frameStart);
+                return true;
+            }
+        }
+        reader.seek(frameStart + 1);
+    }
+    return false;
+}
+
+// Largest gap searched for the first frame (e.g. padding after the ID3v2 tag)
+static constexpr uint32_t MP3_FIRST_FRAME_SEARCH = 8192;
+// Frames sampled across the file when there is no VBR header, and how far
+// to search for a frame at each sample point. Bounds the worst case to a
+// few card blocks per sample.
+static constexpr uint8_t MP3_DURATION_SAMPLES = 8;
+static constexpr uint32_t MP3_SAMPLE_SEARCH = 2048;
+
+// Compute the duration in seconds of the audio between audioStart and audioEnd.
+// Uses the Xing/Info or VBRI header frame count when present; otherwise
+// averages the bitrate of frames sampled evenly across the file.
+static uint32_t estimateMp3Duration(BlockReader &reader, const uint32_t audioStart, const uint32_t audioEnd) {
+    Mp3FrameHeader first{};
+    reader.seek(audioStart);
+    if (!findMp3Frame(reader, MP3_FIRST_FRAME_SEARCH, audioEnd, first)) {
+        return 0;
+    }
+    const uint32_t firstFrame = reader.position();
+
+    // Xing/Info header follows the side information of the first frame
+    uint8_t sideInfo;
+    if (first.version == 1) {
+        sideInfo = first.channelMode == 3 ? 17 : 32;
+    } else {
+        sideInfo = first.channelMode == 3 ? 9 : 17;
+    }
+
+    char tag[4];
+    reader.seek(firstFrame + 4 + sideInfo);
+    if (reader.read(tag, 4) == 4 && (strncmp(tag, "Xing", 4) == 0 || strncmp(tag, "Info", 4) == 0)) {
+        const uint32_t flags = reader.read_u32be();
+        if (flags & 0x01) {
+            const uint32_t frames = reader.read_u32be();
+            if (frames > 0) {
+                return static_cast<uint32_t>(static_cast<uint64_t>(frames) * first.samplesPerFrame / first.sampleRate);
+            }
+        }
+    }
+
+    // VBRI header is always 32 bytes after the frame header
+    reader.seek(firstFrame + 4 + 32);
+    if (reader.read(tag, 4) == 4 && strncmp(tag, "VBRI", 4) == 0) {
+        reader.skip(10); // Version, delay, quality, byte count
+        const uint32_t frames = reader.read_u32be();
+        if (frames > 0) {
+            return static_cast<uint32_t>(static_cast<uint64_t>(frames) * first.samplesPerFrame / first.sampleRate);
+        }
+    }
+
+    // No VBR header: sample frame bitrates at evenly spaced byte offsets and
+    // let each sample stand for its share of the file. For CBR files every
+    // sample agrees with the first frame.
+    const uint32_t audioSize = audioEnd - firstFrame;
+    const uint32_t sampleBytes = audioSize / MP3_DURATION_SAMPLES;
+    uint64_t durationMs = 0;
+    uint32_t coveredBytes = 0;
+    for (uint8_t i = 0; i < MP3_DURATION_SAMPLES; i++) {
+        Mp3FrameHeader frame = first;
+        if (i > 0) {
+            reader.seek(firstFrame + i * sampleBytes);
+            if (!findMp3Frame(reader, MP3_SAMPLE_SEARCH, audioEnd, frame) ||
+                frame.version != first.version || frame.layer != first.layer) {
+                continue;
+            }
+        }
+        // bits / kbps = milliseconds
+        durationMs += static_cast<uint64_t>(sampleBytes) * 8 / frame.bitrate;
+        coveredBytes += sampleBytes;
+    }
+
+    // Scale up for samples that found no frame
+    if (coveredBytes == 0) return 0;
+    return static_cast<uint32_t>(durationMs * audioSize / coveredBytes / 1000);
+}
+
+bool parseMp3Metadata(StorageFile &file, SongMetadata &metadata) {
     if (!file) return false;
 
-    file.seek(0);
+    BlockReader reader(file);
 
     // Initialize with defaults
     metadata.title = "";
@@ -185,11 +326,13 @@ bool parseMp3Metadata(File &file, SongMetadata &metadata) {
     metadata.trackNumber = 0;
     metadata.totalTracks = 0;
 
-    char buffer[128];
+    // Raw frame text; UTF-16 takes two bytes a character
+    char buffer[TAG_TEXT_LEN * 2];
 
     // Try to read the ID3v2 tag first (at the beginning of the file)
+    uint32_t tagEnd = 0;
     char header[10];
-    if (file.read(header, 10) == 10 && strncmp(header, "ID3", 3) == 0) {
+    if (reader.read(header, 10) == 10 && strncmp(header, "ID3", 3) == 0) {
         // ID3v2 tag found
         const uint8_t majorVersion = header[3];
 
@@ -199,13 +342,13 @@ bool parseMp3Metadata(File &file, SongMetadata &metadata) {
                           (static_cast<uint32_t>(header[8] & 0x7F) << 7) |
                           (header[9] & 0x7F);
 
-        const uint32_t tagEnd = 10 + tagSize;
+        tagEnd = 10 + tagSize;
 
         // Parse ID3v2 frames
         uint32_t iterations = 0;
-        while (file.position() < tagEnd && file.available() && iterations++ < MAX_PARSE_ITERATIONS) {
+        while (reader.position() < tagEnd && reader.remaining() > 0 && iterations++ < MAX_PARSE_ITERATIONS) {
             char frameId[5] = {0};
-            if (file.read(frameId, 4) != 4) break;
+            if (reader.read(frameId, 4) != 4) break;
 
             // Check for padding (null bytes)
             if (frameId[0] == 0) break;
@@ -213,25 +356,26 @@ bool parseMp3Metadata(File &file, SongMetadata &metadata) {
             uint32_t frameSize;
             if (majorVersion >= 4) {
                 // ID3v2.4 uses sync safe integers for frame size
-                frameSize = readSyncSafeInt(file);
+                frameSize = reader.read_syncsafe();
             } else {
                 // ID3v2.3 and earlier use regular integers
-                frameSize = readBigEndian32(file);
+                frameSize = reader.read_u32be();
             }
 
             // Skip frame flags
-            file.seek(file.position() + 2);
+            reader.skip(2);
+            const uint32_t frameStart = reader.position();
 
-            if (frameSize > 0 && frameSize < 256) {
+            if (frameSize > 0 && frameSize < sizeof(buffer)) {
                 // Read frame content
-                uint8_t encoding = 0;
-                file.read(&encoding, 1);
+                const int encodingByte = reader.read();
+                const TextEncoding encoding = encodingByte >= 0 && encodingByte <= 3
+                    ? static_cast<TextEncoding>(encodingByte) : TextEncoding::LATIN1;
 
-                const uint32_t textSize = min(frameSize - 1, static_cast<uint32_t>(126));
-                file.read(buffer, textSize);
-                buffer[textSize] = '\0';
+                const uint16_t textSize = reader.read(buffer, min(frameSize - 1, static_cast<uint32_t>(sizeof(buffer) - 1)));
+                // Decoded into display codes here, once, rather than on every draw
+                lcdTranscode(buffer, textSize, encoding, buffer, TAG_TEXT_LEN);
 
-                // Handle different encodings (simplified - assumes ASCII/UTF-8)
                 if (strcmp(frameId, "TIT2") == 0) {
                     metadata.title = buffer;
                 } else if (strcmp(frameId, "TPE1") == 0) {
@@ -242,136 +386,86 @@ bool parseMp3Metadata(File &file, SongMetadata &metadata) {
                     // Track number may be "N" or "N/M" format
                     parseTrackNumber(buffer, metadata.trackNumber, metadata.totalTracks);
                 }
-
-                // Skip remaining bytes if the frame was larger
-                if (frameSize > textSize + 1) {
-                    file.seek(file.position() + (frameSize - textSize - 1));
-                }
-            } else {
-                // Skip large or empty frames
-                file.seek(file.position() + frameSize);
             }
-        }
-    }
 
-    // If no ID3v2 metadata found, try ID3v1 at the end of the file
-    if (metadata.title.length() == 0 && metadata.artist.length() == 0) {
-        // ID3v1 tag is 128 bytes at the end of the file
-        if (file.size() > 128) {
-            file.seek(file.size() - 128);
-
-            char tag[4] = {0};
-            if (file.read(tag, 3) == 3 && strcmp(tag, "TAG") == 0) {
-                // ID3v1 tag found
-                char title[31] = {0};
-                char artist[31] = {0};
-                char album[31] = {0};
-
-                file.read(title, 30);
-                file.read(artist, 30);
-                file.read(album, 30);
-
-                // Trim trailing spaces
-                for (int i = 29; i >= 0 && title[i] == ' '; i--) title[i] = '\0';
-                for (int i = 29; i >= 0 && artist[i] == ' '; i--) artist[i] = '\0';
-                for (int i = 29; i >= 0 && album[i] == ' '; i--) album[i] = '\0';
-
-                if (strlen(title) > 0) metadata.title = title;
-                if (strlen(artist) > 0) metadata.artist = artist;
-                if (strlen(album) > 0) metadata.album = album;
-            }
-            // ID3v1.1: Track number is stored at byte 126 if byte 125 is zero
-            // Note: ID3v1 does not support total tracks
-            file.seek(file.size() - 3);
-            uint8_t zeroByte, trackNum;
-            file.read(&zeroByte, 1);
-            file.read(&trackNum, 1);
-            if (zeroByte == 0 && trackNum > 0) {
-                metadata.trackNumber = trackNum;
-            }
+            // Skip the rest of the frame; large frames (cover art) are never read
+            if (!reader.seek(frameStart + frameSize)) break;
         }
     }
 
-    // Estimate duration by finding the first valid MP3 frame
-    file.seek(0);
-
-    // Skip ID3v2 tag if present
-    if (file.read(header, 3) == 3 && strncmp(header, "ID3", 3) == 0) {
-        file.seek(6);
-        const uint32_t tagSize = readSyncSafeInt(file);
-        file.seek(10 + tagSize);
-    } else {
-        file.seek(0);
+    // ID3v1 tag is 128 bytes at the end of the file
+    bool hasId3v1 = false;
+    if (reader.size() > 128) {
+        reader.seek(reader.size() - 128);
+        char tag[3];
+        hasId3v1 = reader.read(tag, 3) == 3 && strncmp(tag, "TAG", 3) == 0;
     }
 
-    // Search for MP3 frame sync
-    uint32_t searchIterations = 0;
-    while (file.available() && searchIterations++ < 8192) {
-        uint8_t syncByte;
-        file.read(&syncByte, 1);
-        if (syncByte == 0xFF) {
-            uint8_t frameByte;
-            file.read(&frameByte, 1);
-            if ((frameByte & 0xE0) == 0xE0) {
-                // Found frame sync, parse header
-                uint8_t headerBytes[2];
-                file.read(headerBytes, 2);
-
-                // Extract bitrate index
-                const uint8_t bitrateIndex = (headerBytes[0] >> 4) & 0x0F;
-
-                // Bitrate table for MPEG1 Layer 3
-                static const uint16_t bitrates[] = {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0};
-
-                if (bitrateIndex > 0 && bitrateIndex < 15) {
-                    const uint32_t bitrate = bitrates[bitrateIndex] * 1000;
-                    uint32_t audioSize = file.size();
-
-                    // Subtract ID3v1 tag size if present
-                    if (audioSize > 128) {
-                        file.seek(file.size() - 128);
-                        char tag[4] = {0};
-                        file.read(tag, 3);
-                        if (strcmp(tag, "TAG") == 0) {
-                            audioSize -= 128;
-                        }
-                    }
-
-                    if (bitrate > 0) {
-                        metadata.duration = (audioSize * 8) / bitrate;
-                    }
-                }
-                break;
-            }
+    // If no ID3v2 metadata found, try ID3v1 at the end of the file
+    if (hasId3v1 && metadata.title.length() == 0 && metadata.artist.length() == 0) {
+        // The reader is positioned just after "TAG"
+        char title[31] = {0};
+        char artist[31] = {0};
+        char album[31] = {0};
+
+        reader.read(title, 30);
+        reader.read(artist, 30);
+        reader.read(album, 30);
+
+        // Trim trailing spaces
+        for (int i = 29; i >= 0 && title[i] == ' '; i--) title[i] = '\0';
+        for (int i = 29; i >= 0 && artist[i] == ' '; i--) artist[i] = '\0';
+        for (int i = 29; i >= 0 && album[i] == ' '; i--) album[i] = '\0';
+
+        // ID3v1 text is Latin-1
+        lcdTranscode(title, 30, TextEncoding::LATIN1, title, sizeof(title));
+        lcdTranscode(artist, 30, TextEncoding::LATIN1, artist, sizeof(artist));
+        lcdTranscode(album, 30, TextEncoding::LATIN1, album, sizeof(album));
+
+        if (strlen(title) > 0) metadata.title = title;
+        if (strlen(artist) > 0) metadata.artist = artist;
+        if (strlen(album) > 0) metadata.album = album;
+
+        // ID3v1.1: Track number is stored at byte 126 if byte 125 is zero
+        // Note: ID3v1 does not support total tracks
+        reader.seek(reader.size() - 3);
+        const int zeroByte = reader.read();
+        const int trackNum = reader.read();
+        if (zeroByte == 0 && trackNum > 0) {
+            metadata.trackNumber = trackNum;
         }
     }
 
+    // Duration comes from the audio frames between the ID3v2 and ID3v1 tags
+    const uint32_t audioEnd = hasId3v1 ? reader.size() - 128 : reader.size();
+    metadata.duration = estimateMp3Duration(reader, tagEnd, audioEnd);
+
     // Fall back to filename if no title found
     if (metadata.title.length() == 0) {
-        metadata.title = getFilenameWithoutExtension(file.name());
+        metadata.title = fileTitle(file);
     }
 
     return true;
 }
 
 // Parse Vorbis comment block (OGG)
-static void parseVorbisComments(File &file, uint32_t blockLength, SongMetadata &metadata) {
-    const uint32_t startPos = file.position();
+static void parseVorbisComments(BlockReader &reader, uint32_t blockLength, SongMetadata &metadata) {
+    const uint32_t startPos = reader.position();
     const uint32_t endPos = startPos + blockLength;
-    
+
     // Read vendor string length
-    const uint32_t vendorLength = readLittleEndian32(file);
+    const uint32_t vendorLength = reader.read_u32le();
 
     // Bounds check before seeking
-    if (vendorLength > blockLength || file.position() + vendorLength > endPos) {
+    if (vendorLength > blockLength || reader.position() + vendorLength > endPos) {
         return;
     }
 
     // Skip vendor string
-    file.seek(file.position() + vendorLength);
+    reader.skip(vendorLength);
 
     // Read the number of comments
-    uint32_t numComments = readLittleEndian32(file);
+    uint32_t numComments = reader.read_u32le();
 
     // Limit to a reasonable number
     if (numComments > MAX_PARSE_ITERATIONS) {
@@ -380,16 +474,16 @@ static void parseVorbisComments(File &file, uint32_t blockLength, SongMetadata &
 
     char buffer[128];
 
-    for (uint32_t i = 0; i < numComments && file.available() && file.position() < endPos; i++) {
-        const uint32_t commentLength = readLittleEndian32(file);
+    for (uint32_t i = 0; i < numComments && reader.remaining() > 0 && reader.position() < endPos; i++) {
+        const uint32_t commentLength = reader.read_u32le();
 
         // Bounds check
-        if (file.position() + commentLength > endPos) {
+        if (reader.position() + commentLength > endPos) {
             break;
         }
 
         if (commentLength > 0 && commentLength < sizeof(buffer) - 1) {
-            file.read(buffer, commentLength);
+            reader.read(buffer, commentLength);
             buffer[commentLength] = '\0';
 
             // Parse key=value format
@@ -397,7 +491,9 @@ static void parseVorbisComments(File &file, uint32_t blockLength, SongMetadata &
             if (equals) {
                 *equals = '\0';
                 char* key = buffer;
-                const char* value = equals + 1;
+                // Vorbis comments are UTF-8
+                char* value = equals + 1;
+                lcdTranscode(value, buffer + commentLength - value, TextEncoding::UTF8, value, buffer + sizeof(buffer) - value);
 
                 // Convert key to uppercase for comparison
                 for (char* p = key; *p; p++) {
@@ -420,15 +516,75 @@ static void parseVorbisComments(File &file, uint32_t blockLength, SongMetadata &
             }
         } else {
             // Skip large comments
-            file.seek(file.position() + commentLength);
+            reader.skip(commentLength);
         }
     }
 }
 
-bool parseOggMetadata(File &file, SongMetadata &metadata) {
+// OGG pages are at most ~64 KB, so the last page header is always within this
+static constexpr uint32_t MAX_OGG_TAIL_SEARCH = 65536 + 512;
+
+// CRC-32 as used by OGG (polynomial 0x04C11DB7, no reflection), nibble table
+static uint32_t oggCrcUpdate(uint32_t crc, const uint8_t* data, const uint16_t length) {
+    static const uint32_t table[16] = {
+        0x00000000, 0x04C11DB7, 0x09823B6E, 0x0D4326D9, 0x130476DC, 0x17C56B6B, 0x1A864DB2, 0x1E475005,
+        0x2608EDB8, 0x22C9F00F, 0x2F8AD6D6, 0x2B4BCB61, 0x350C9B64, 0x31CD86D3, 0x3C8EA00A, 0x384FBDBD
+    };
+    for (uint16_t i = 0; i < length; i++) {
+        crc ^= static_cast<uint32_t>(data[i]) << 24;
+        crc = (crc << 4) ^ table[crc >> 28];
+        crc = (crc << 4) ^ table[crc >> 28];
+    }
+    return crc;
+}
+
+// Validate the OGG page at pageStart (version, stream serial and CRC) and
+// return its granule position. Returns false for anything that merely looks
+// like a capture pattern inside audio data.
+static bool readOggPageGranule(BlockReader &reader, const uint32_t pageStart, const uint32_t serialNumber, uint64_t &granulePos) {
+    uint8_t header[27 + 255];
+    reader.seek(pageStart);
+    if (reader.read(header, 27) != 27) return false;
+    if (header[4] != 0 || (header[5] & ~0x07) != 0) return false;
+
+    const uint8_t pageSegments = header[26];
+    if (reader.read(header + 27, pageSegments) != pageSegments) return false;
+
+    granulePos = 0;
+    for (int i = 13; i >= 6; i--) {
+        granulePos = (granulePos << 8) | header[i];
+    }
+    const uint32_t pageSerial = static_cast<uint32_t>(header[14]) | (static_cast<uint32_t>(header[15]) << 8) |
+                                (static_cast<uint32_t>(header[16]) << 16) | (static_cast<uint32_t>(header[17]) << 24);
+    if (pageSerial != serialNumber || granulePos == 0xFFFFFFFFFFFFFFFFULL) return false;
+
+    const uint32_t expectedCrc = static_cast<uint32_t>(header[22]) | (static_cast<uint32_t>(header[23]) << 8) |
+                                 (static_cast<uint32_t>(header[24]) << 16) | (static_cast<uint32_t>(header[25]) << 24);
+    header[22] = header[23] = header[24] = header[25] = 0;
+
+    uint32_t pageDataSize = 0;
+    for (uint8_t i = 0; i < pageSegments; i++) {
+        pageDataSize += header[27 + i];
+    }
+    if (reader.remaining() < pageDataSize) return false;
+
+    uint32_t crc = oggCrcUpdate(0, header, 27 + pageSegments);
+
+    // Reuse the header buffer for the page body
+    while (pageDataSize > 0) {
+        const uint16_t chunk = reader.read(header, min(pageDataSize, static_cast<uint32_t>(sizeof(header))));
+        if (chunk == 0) return false;
+        crc = oggCrcUpdate(crc, header, chunk);
+        pageDataSize -= chunk;
+    }
+
+    return crc == expectedCrc;
+}
+
+bool parseOggMetadata(StorageFile &file, SongMetadata &metadata) {
     if (!file) return false;
 
-    file.seek(0);
+    BlockReader reader(file);
 
     // Initialize with defaults
     metadata.title = "";
@@ -440,128 +596,106 @@ bool parseOggMetadata(File &file, SongMetadata &metadata) {
 
     // Check for "OggS" magic number
     char magic[4];
-    if (file.read(magic, 4) != 4 || strncmp(magic, "OggS", 4) != 0) {
+    if (reader.read(magic, 4) != 4 || strncmp(magic, "OggS", 4) != 0) {
         return false;
     }
 
     uint32_t sampleRate = 0;
+    uint32_t serialNumber = 0;
     uint64_t lastGranulePos = 0;
 
     // Reset to beginning
-    file.seek(0);
+    reader.seek(0);
 
     // Parse OGG pages looking for Vorbis headers
     int pageCount = 0;
-    while (file.available() && pageCount < 10) {
+    while (reader.remaining() > 0 && pageCount < 10) {
         // Read the page header
         char pageSync[4];
-        if (file.read(pageSync, 4) != 4 || strncmp(pageSync, "OggS", 4) != 0) {
+        if (reader.read(pageSync, 4) != 4 || strncmp(pageSync, "OggS", 4) != 0) {
             break;
         }
 
-        // Skip version
-        file.seek(file.position() + 1);
-
-        // Skip header type
-        file.seek(file.position() + 1);
+        // Skip version and header type
+        reader.skip(2);
 
         // Granule position (8 bytes, little-endian)
-        uint8_t granuleBytes[8];
-        file.read(granuleBytes, 8);
-        uint64_t granulePos = 0;
-        for (int i = 7; i >= 0; i--) {
-            granulePos = (granulePos << 8) | granuleBytes[i];
-        }
+        const uint64_t granulePos = reader.read_u64le();
         if (granulePos != 0xFFFFFFFFFFFFFFFFULL) {
             lastGranulePos = granulePos;
         }
 
-        // Skip bitstream serial number (4 bytes) and page sequence number (4 bytes)
-        file.seek(file.position() + 8);
-
-        // Skip CRC checksum (4 bytes)
-        file.seek(file.position() + 4);
+        // Bitstream serial number (4 bytes), then skip the page sequence
+        // number (4 bytes) and CRC checksum (4 bytes)
+        const uint32_t pageSerial = reader.read_u32le();
+        if (pageCount == 0) {
+            serialNumber = pageSerial;
+        }
+        reader.skip(8);
 
         // Page segments
-        uint8_t pageSegments;
-        file.read(&pageSegments, 1);
+        const int pageSegments = reader.read();
+        if (pageSegments < 0) break;
 
         // Read the segment table
+        uint8_t segments[255];
+        const uint16_t segmentsRead = reader.read(segments, pageSegments);
         uint32_t pageDataSize = 0;
-        for (uint8_t i = 0; i < pageSegments; i++) {
-            uint8_t segSize;
-            file.read(&segSize, 1);
-            pageDataSize += segSize;
+        for (uint16_t i = 0; i < segmentsRead; i++) {
+            pageDataSize += segments[i];
         }
 
-        const uint32_t pageDataStart = file.position();
+        const uint32_t pageDataStart = reader.position();
 
         // Check for Vorbis identification header
         if (pageCount == 0) {
-            uint8_t packetType;
-            file.read(&packetType, 1);
+            const int packetType = reader.read();
 
             char vorbis[6];
-            file.read(vorbis, 6);
+            reader.read(vorbis, 6);
 
             if (packetType == 1 && strncmp(vorbis, "vorbis", 6) == 0) {
                 // Vorbis identification header
-                file.seek(file.position() + 4); // Skip version
+                reader.skip(4); // Skip version
 
                 // Skip channels
-                file.seek(file.position() + 1);
+                reader.skip(1);
 
-                sampleRate = readLittleEndian32(file);
+                sampleRate = reader.read_u32le();
             }
         } else if (pageCount == 1) {
             // Second page usually contains comment header
-            uint8_t packetType;
-            file.read(&packetType, 1);
+            const int packetType = reader.read();
 
             char vorbis[6];
-            file.read(vorbis, 6);
+            reader.read(vorbis, 6);
 
             if (packetType == 3 && strncmp(vorbis, "vorbis", 6) == 0) {
                 // Vorbis comment header
-                parseVorbisComments(file, pageDataSize - 7, metadata);
+                parseVorbisComments(reader, pageDataSize - 7, metadata);
             }
         }
 
         // Move to the next page
-        file.seek(pageDataStart + pageDataSize);
+        if (!reader.seek(pageDataStart + pageDataSize)) break;
         pageCount++;
     }
 
-    // To get accurate duration, find the last OGG page
-    // Seek near the end of the file and look for the last "OggS"
-    uint32_t searchStart = 0;
-    if (file.size() > 65536) {
-        searchStart = file.size() - 65536;
-    }
-    file.seek(searchStart);
-
-    // Search for the last OggS page
-    uint32_t searchIterations = 0;
-    while (file.available() && searchIterations++ < 65536) {
-        char c;
-        file.read(&c, 1);
-        if (c == 'O') {
-            char ggs[3];
-            if (file.read(ggs, 3) == 3 && strncmp(ggs, "ggS", 3) == 0) {
-                // Found a page, read granule position
-                file.seek(file.position() + 2); // Skip version and header type
-
-                uint8_t granuleBytes[8];
-                file.read(granuleBytes, 8);
-                uint64_t granulePos = 0;
-                for (int i = 7; i >= 0; i--) {
-                    granulePos = (granulePos << 8) | granuleBytes[i];
-                }
-                if (granulePos != 0xFFFFFFFFFFFFFFFFULL && granulePos > lastGranulePos) {
-                    lastGranulePos = granulePos;
-                }
+    // To get accurate duration, find the last OGG page by searching
+    // backwards from the end of the file (normally only the last block)
+    const uint32_t tailStart = reader.size() > MAX_OGG_TAIL_SEARCH ? reader.size() - MAX_OGG_TAIL_SEARCH : 0;
+    reader.seek(reader.size());
+    while (reader.rfind("OggS", 4, reader.position() - tailStart)) {
+        const uint32_t pageStart = reader.position();
+        uint64_t granulePos;
+        if (readOggPageGranule(reader, pageStart, serialNumber, granulePos)) {
+            if (granulePos > lastGranulePos) {
+                lastGranulePos = granulePos;
             }
+            break;
         }
+        // Not a real page (or a page from another stream), keep looking
+        reader.seek(pageStart);
     }
 
     // Calculate duration
@@ -571,16 +705,17 @@ bool parseOggMetadata(File &file, SongMetadata &metadata) {
 
     // Fall back to filename if no title found
     if (metadata.title.length() == 0) {
-        metadata.title = getFilenameWithoutExtension(file.name());
+        metadata.title = fileTitle(file);
     }
 
     return true;
 }
 
-bool parseMetadata(File &file, SongMetadata &metadata) {
+bool parseMetadata(StorageFile &file, SongMetadata &metadata) {
     if (!file) return false;
 
-    const String ext = getFileExtension(file.name());
+    char name[STORAGE_NAME_LEN];
+    const String ext = file.getName(name, sizeof(name)) ? getFileExtension(name) : String();
 
     if (ext == "wav") {
         return parseWavMetadata(file, metadata);
@@ -591,7 +726,7 @@ bool parseMetadata(File &file, SongMetadata &metadata) {
     }
 
     // Unknown format - try to at least set a title from filename
-    metadata.title = getFilenameWithoutExtension(file.name());
+    metadata.title = fileTitle(file);
     metadata.artist = "";
     metadata.album = "";
     metadata.duration = 0;
@@ -0,0 +1,57 @@
+#include "render_scheduler.h"
+
+RenderScheduler::RenderScheduler(const uint8_t maxFps) {
+    setMaxFps(maxFps);
+}
+
+void RenderScheduler::setMaxFps(const uint8_t maxFps) {
+    _intervalMs = maxFps ? 1000 / maxFps : 0;
+}
+
+void RenderScheduler::invalidate() {
+    _dirty = true;
+    _changes++;
+}
+
+void RenderScheduler::flush() {
+    invalidate();
+    _urgent = true;
+}
+
+bool RenderScheduler::shouldRender() {
+    if (!_dirty) return false;
+    return _urgent || static_cast<int32_t>(millis() - _lastFrame) >= _intervalMs;
+}
+
+void RenderScheduler::rendered(const uint32_t cells, const uint32_t busUs, const uint32_t frameUs) {
+    _dirty = false;
+    _urgent = false;
+    _lastFrame = millis();
+
+    _stats.frames++;
+    _stats.cells += cells;
+    _stats.busUs += busUs;
+    if (frameUs > _stats.maxFrameUs) _stats.maxFrameUs = frameUs;
+    if (_changes > 1) _stats.coalesced += _changes - 1;
+    _changes = 0;
+}
+
+void RenderScheduler::report(Print& out) {
+    const uint32_t ms = millis() - _statsSince;
+    const double seconds = ms ? ms / 1000.0 : 1.0;
+    out.print("render: ");
+    out.print(_stats.frames / seconds);
+    out.print(" frames/s, ");
+    out.print(_stats.cells / seconds);
+    out.print(" cells/s, ");
+    out.print(_stats.busUs / seconds / 1000.0);
+    out.print(" ms/s in I2C, max ");
+    out.print(_stats.maxFrameUs);
+    out.print(" us a frame, coalesced ");
+    out.println(_stats.coalesced);
+}
+
+void RenderScheduler::resetStats() {
+    _stats = RenderStats();
+    _statsSince = millis();
+}
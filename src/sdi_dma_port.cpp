@@ -0,0 +1,111 @@
+#include "sdi_dma_port.h"
+
+#ifdef SDI_DMA_SUPPORTED
+
+#include <SPI.h>
+#include <Adafruit_VS1053.h>
+
+static SdiScheduler* dma_scheduler = nullptr;
+
+#ifdef __SAMD51__
+
+static void burst_done(Adafruit_ZeroDMA*) {
+    dma_scheduler->complete();
+}
+
+bool SdiDmaPort::begin(SdiScheduler& sdi) {
+    dma_scheduler = &sdi;
+    _dma.setTrigger(SPI.getDMAC_ID_TX());
+    _dma.setAction(DMA_TRIGGER_ACTON_BEAT);
+    if (_dma.allocate() != DMA_STATUS_OK) return false;
+    static uint8_t placeholder = 0;
+    _descriptor = _dma.addDescriptor(&placeholder, SPI.getDataRegister(), 1, DMA_BEAT_SIZE_BYTE, true, false);
+    if (!_descriptor) return false;
+    _dma.setCallback(burst_done);
+    return true;
+}
+
+void SdiDmaPort::startBurst(const uint8_t* data, const uint8_t length) {
+    SPI.beginTransaction(VS1053_DATA_SPI_SETTING);
+    digitalWrite(_dcsPin, LOW);
+    _dma.changeDescriptor(_descriptor, const_cast<uint8_t*>(data), SPI.getDataRegister(), length);
+    _dma.startJob();
+}
+
+bool SdiDmaPort::burstBusy() {
+    return _dma.isActive() || !SPI.getSercom()->SPI.INTFLAG.bit.TXC;
+}
+
+void SdiDmaPort::endBurst() {
+    Sercom* sercom = SPI.getSercom();
+    while (!sercom->SPI.INTFLAG.bit.TXC) {}
+    while (sercom->SPI.INTFLAG.bit.RXC) {
+        (void)sercom->SPI.DATA.reg;
+    }
+    sercom->SPI.STATUS.bit.BUFOVF = 1;
+    digitalWrite(_dcsPin, HIGH);
+    SPI.endTransaction();
+}
+
+#else // RP2040
+
+#include <hardware/dma.h>
+#include <hardware/irq.h>
+#include <hardware/spi.h>
+
+// The SPI peripheral behind SPI, spi0 on the Feather RP2040
+#ifndef SDI_SPI
+#define SDI_SPI spi0
+#endif
+
+static int dma_channel = -1;
+
+// DMA_IRQ_0 is shared with other users of the DMA controller
+static void burst_done() {
+    if (!dma_channel_get_irq0_status(dma_channel)) return;
+    dma_channel_acknowledge_irq0(dma_channel);
+    dma_scheduler->complete();
+}
+
+bool SdiDmaPort::begin(SdiScheduler& sdi) {
+    dma_scheduler = &sdi;
+    _channel = dma_claim_unused_channel(false);
+    if (_channel < 0) return false;
+    dma_channel = _channel;
+
+    dma_channel_config config = dma_channel_get_default_config(_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+    channel_config_set_dreq(&config, spi_get_dreq(SDI_SPI, true));
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);
+    dma_channel_configure(_channel, &config, &spi_get_hw(SDI_SPI)->dr, nullptr, 0, false);
+
+    dma_channel_set_irq0_enabled(_channel, true);
+    irq_add_shared_handler(DMA_IRQ_0, burst_done, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0, true);
+    return true;
+}
+
+void SdiDmaPort::startBurst(const uint8_t* data, const uint8_t length) {
+    SPI.beginTransaction(VS1053_DATA_SPI_SETTING);
+    digitalWrite(_dcsPin, LOW);
+    dma_channel_transfer_from_buffer_now(_channel, data, length);
+}
+
+bool SdiDmaPort::burstBusy() {
+    return dma_channel_is_busy(_channel) || spi_is_busy(SDI_SPI);
+}
+
+void SdiDmaPort::endBurst() {
+    while (spi_is_busy(SDI_SPI)) {}
+    while (spi_is_readable(SDI_SPI)) {
+        (void)spi_get_hw(SDI_SPI)->dr;
+    }
+    spi_get_hw(SDI_SPI)->icr = SPI_SSPICR_RORIC_BITS;
+    digitalWrite(_dcsPin, HIGH);
+    SPI.endTransaction();
+}
+
+#endif
+
+#endif
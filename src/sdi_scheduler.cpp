@@ -0,0 +1,62 @@
+#include "sdi_scheduler.h"
+
+void SdiScheduler::send(const uint8_t* data, const uint8_t length) {
+    const uint8_t count = length < BURST_SIZE ? length : BURST_SIZE;
+    memcpy(_buffer, data, count);
+    _active = true;
+    _bursts++;
+    _port.startBurst(_buffer, count);
+}
+
+// End the burst in flight. Returns false if there was none, which happens
+// when finish() has already ended it and the interrupt comes in late.
+bool SdiScheduler::end() {
+    noInterrupts();
+    const bool active = _active;
+    if (active) {
+        _port.endBurst();
+        _active = false;
+    }
+    interrupts();
+    return active;
+}
+
+void SdiScheduler::complete() {
+    if (end() && _claims == 0 && _onIdle) {
+        _onIdle();
+    }
+}
+
+void SdiScheduler::finish() {
+    // Polled rather than waiting for complete(): from the DREQ interrupt the
+    // DMA interrupt may not be able to preempt
+    while (_active) {
+        if (!_port.burstBusy()) end();
+    }
+}
+
+// Fill the decoder before the bus is given up, so it has as much as possible
+// to play meanwhile. Right after a track starts only the first burst has gone
+// out, and the card is about to be busy opening the next one.
+void SdiScheduler::topUp() {
+    if (!_onIdle) return;
+    finish();
+    while (ready()) {
+        _onIdle();
+        if (!_active) return; // nothing to send
+        finish();
+    }
+}
+
+void SdiScheduler::claimBus() {
+    if (_claims == 0) topUp();
+    _claims++;
+    if (_active) _claimWaits++;
+    finish();
+}
+
+void SdiScheduler::releaseBus() {
+    if (_claims > 0 && --_claims == 0 && _onIdle) {
+        _onIdle();
+    }
+}
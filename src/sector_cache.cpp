@@ -0,0 +1,38 @@
+#include "sector_cache.h"
+
+SectorCache sector_cache;
+
+const uint8_t* SectorCache::read(StorageFile& file, const uint32_t sector, uint16_t& length) {
+    const uint32_t fileId = file.id();
+    if (fileId == 0) return nullptr;
+    _clock++;
+
+    // Hit, or else the empty or least recently used slot
+    uint8_t victim = 0;
+    for (uint8_t i = 0; i < CAPACITY; i++) {
+        Slot& slot = _slots[i];
+        if (slot.fileId == fileId && slot.sector == sector) {
+            stats.hits++;
+            slot.lastUse = _clock;
+            length = slot.length;
+            return _data[i];
+        }
+        if (_slots[victim].fileId != 0 && (slot.fileId == 0 || slot.lastUse < _slots[victim].lastUse)) {
+            victim = i;
+        }
+    }
+
+    stats.misses++;
+    Slot& slot = _slots[victim];
+    slot.fileId = 0;
+    if (!file.seek(sector * SECTOR_SIZE)) return nullptr;
+    const int bytesRead = file.read(_data[victim], SECTOR_SIZE);
+    if (bytesRead <= 0) return nullptr;
+
+    slot.fileId = fileId;
+    slot.sector = sector;
+    slot.lastUse = _clock;
+    slot.length = bytesRead;
+    length = slot.length;
+    return _data[victim];
+}
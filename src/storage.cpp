@@ -0,0 +1,88 @@
+#include "storage.h"
+
+Storage storage;
+StorageBus storage_bus;
+uint32_t StorageFile::_lastId = 0;
+
+#ifdef STORAGE_SDFAT
+
+// The VS1053 shares the bus with the card, so by default SdFat has to
+// release the bus after every command. Boards with the card on its own
+// SPI bus can build with -D STORAGE_DEDICATED_SPI to keep multi-block
+// reads open between calls.
+#ifdef STORAGE_DEDICATED_SPI
+#define STORAGE_SPI_MODE DEDICATED_SPI
+#else
+#define STORAGE_SPI_MODE SHARED_SPI
+#endif
+
+#ifndef STORAGE_SPI_MHZ
+#define STORAGE_SPI_MHZ 24
+#endif
+
+static SdFs sd;
+
+bool Storage::begin(const uint8_t csPin) {
+    const StorageBusLock lock;
+    return sd.begin(SdSpiConfig(csPin, STORAGE_SPI_MODE, SD_SCK_MHZ(STORAGE_SPI_MHZ)));
+}
+
+StorageFile Storage::open(const char* path, const StorageMode mode) {
+    const StorageBusLock lock;
+    StorageFile file;
+    const oflag_t flags = mode == StorageMode::WRITE ? O_RDWR | O_CREAT | O_AT_END : O_RDONLY;
+    file._file = sd.open(path, flags);
+    if (file._file.isOpen()) file._id = ++StorageFile::_lastId;
+    return file;
+}
+
+bool Storage::exists(const char* path) {
+    const StorageBusLock lock;
+    return sd.exists(path);
+}
+
+bool Storage::remove(const char* path) {
+    const StorageBusLock lock;
+    return sd.remove(path);
+}
+
+const char* Storage::volumeType() {
+    switch (sd.fatType()) {
+        case FAT_TYPE_EXFAT: return "exFAT";
+        case FAT_TYPE_FAT32: return "FAT32";
+        case FAT_TYPE_FAT16: return "FAT16";
+        default: return "FAT12";
+    }
+}
+
+#else
+
+bool Storage::begin(const uint8_t csPin) {
+    const StorageBusLock lock;
+    return SD.begin(csPin);
+}
+
+StorageFile Storage::open(const char* path, const StorageMode mode) {
+    const StorageBusLock lock;
+    StorageFile file;
+    file._file = SD.open(path, mode == StorageMode::WRITE ? FILE_WRITE : FILE_READ);
+    if (file._file) file._id = ++StorageFile::_lastId;
+    return file;
+}
+
+bool Storage::exists(const char* path) {
+    const StorageBusLock lock;
+    return SD.exists(path);
+}
+
+bool Storage::remove(const char* path) {
+    const StorageBusLock lock;
+    return SD.remove(path);
+}
+
+// The SD library only mounts FAT16 and FAT32 and does not say which
+const char* Storage::volumeType() {
+    return "FAT";
+}
+
+#endif
@@ -0,0 +1,98 @@
+#include "string_arena.h"
+#include <stdlib.h>
+
+// Arena offsets are 16 bits
+static constexpr uint32_t ARENA_MAX = 0xFFFF;
+
+bool StringArena::reserve(const uint16_t capacity) {
+    release();
+    // Offset 0 holds the empty string
+    _data = static_cast<char*>(malloc(capacity > 0 ? capacity : 1));
+    if (!_data) return false;
+    _data[0] = '\0';
+    _size = 1;
+    _capacity = capacity > 0 ? capacity : 1;
+    return true;
+}
+
+bool StringArena::grow(const uint32_t needed) {
+    if (needed > ARENA_MAX) return false;
+    uint32_t capacity = _capacity;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    if (capacity > ARENA_MAX) capacity = ARENA_MAX;
+
+    char* data = static_cast<char*>(realloc(_data, capacity));
+    if (!data) return false;
+    _data = data;
+    _capacity = capacity;
+    return true;
+}
+
+TextRef StringArena::add(const char* text, const size_t length) {
+    if (!_data || length == 0) return 0;
+
+    const uint32_t needed = static_cast<uint32_t>(_size) + length + 1;
+    if (needed > _capacity && !grow(needed)) {
+        Serial.println("String arena full!");
+        return 0;
+    }
+
+    const TextRef ref = _size;
+    memcpy(_data + _size, text, length);
+    _data[_size + length] = '\0';
+    _size = needed;
+    return ref;
+}
+
+void StringArena::shrink() {
+    if (!_data || _size == _capacity) return;
+    char* data = static_cast<char*>(realloc(_data, _size));
+    if (data) {
+        _data = data;
+        _capacity = _size;
+    }
+}
+
+void StringArena::release() {
+    free(_data);
+    _data = nullptr;
+    _size = 0;
+    _capacity = 0;
+}
+
+void StringInterner::reset(StringArena& arena) {
+    _arena = &arena;
+    memset(_slots, 0, sizeof(_slots));
+}
+
+TextRef StringInterner::intern(const char* text) {
+    const size_t length = strlen(text);
+    if (length == 0 || !_arena) return 0;
+
+    // FNV-1a, probing linearly from the hashed slot
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= static_cast<uint8_t>(text[i]);
+        hash *= 16777619u;
+    }
+
+    uint8_t slot = hash % SLOTS;
+    for (uint8_t probe = 0; probe < SLOTS; probe++) {
+        const TextRef ref = _slots[slot];
+        if (ref == 0) {
+            // Not seen before
+            const TextRef added = _arena->add(text, length);
+            _slots[slot] = added;
+            return added;
+        }
+        if (strcmp(_arena->at(ref), text) == 0) {
+            return ref;
+        }
+        slot = (slot + 1) % SLOTS;
+    }
+
+    // Table full - store it without deduplication
+    return _arena->add(text, length);
+}
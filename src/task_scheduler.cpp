@@ -0,0 +1,98 @@
+#include "task_scheduler.h"
+
+static bool reached(const uint32_t now, const uint32_t time) {
+    return static_cast<int32_t>(now - time) >= 0;
+}
+
+int8_t TaskScheduler::add(const char* name, void (*run)(), const uint16_t periodMs, const uint8_t priority) {
+    if (_count >= MAX_TASKS) return -1;
+    Task& task = _tasks[_count];
+    task.name = name;
+    task.run = run;
+    task.periodMs = periodMs;
+    task.priority = priority;
+    task.due = millis() + periodMs;
+    return static_cast<int8_t>(_count++);
+}
+
+bool TaskScheduler::runNext() {
+    const uint32_t now = millis();
+
+    // Earliest deadline among the periodic tasks that are due
+    Task* next = nullptr;
+    for (uint8_t i = 0; i < _count; i++) {
+        Task& task = _tasks[i];
+        if (task.periodMs == 0 || !reached(now, task.due)) continue;
+        if (!next) {
+            next = &task;
+            continue;
+        }
+        const int32_t sooner = static_cast<int32_t>((task.due + task.periodMs) - (next->due + next->periodMs));
+        if (sooner < 0 || (sooner == 0 && task.priority < next->priority)) {
+            next = &task;
+        }
+    }
+    if (next) {
+        runTask(*next, now);
+        return true;
+    }
+
+    // Background tasks take turns
+    for (uint8_t i = 0; i < _count; i++) {
+        const uint8_t index = (_nextBackground + i) % _count;
+        if (_tasks[index].periodMs == 0) {
+            _nextBackground = (index + 1) % _count;
+            runTask(_tasks[index], now);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskScheduler::runTask(Task& task, const uint32_t now) {
+    if (task.periodMs > 0) {
+        if (reached(now, task.due + task.periodMs)) {
+            // Late by a whole period: start over from now. The first run
+            // waits for setup() to finish, which does not count.
+            if (task.started) task.stats.missed++;
+            task.due = now + task.periodMs;
+        } else {
+            task.due += task.periodMs;
+        }
+    }
+
+    task.started = true;
+    const uint32_t start = micros();
+    task.run();
+    const uint32_t elapsed = micros() - start;
+
+    task.stats.runs++;
+    task.stats.totalUs += elapsed;
+    if (elapsed > task.stats.maxUs) task.stats.maxUs = elapsed;
+}
+
+void TaskScheduler::wake(const int8_t task) {
+    if (task < 0 || task >= _count) return;
+    _tasks[task].due = millis();
+}
+
+void TaskScheduler::report(Print& out) {
+    for (uint8_t i = 0; i < _count; i++) {
+        const Task& task = _tasks[i];
+        out.print(task.name);
+        out.print(": ");
+        out.print(task.stats.runs);
+        out.print(" runs, mean ");
+        out.print(task.stats.runs ? task.stats.totalUs / task.stats.runs : 0);
+        out.print(" us, max ");
+        out.print(task.stats.maxUs);
+        out.print(" us, missed ");
+        out.println(task.stats.missed);
+    }
+}
+
+void TaskScheduler::resetStats() {
+    for (uint8_t i = 0; i < _count; i++) {
+        _tasks[i].stats = TaskStats();
+    }
+}